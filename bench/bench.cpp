@@ -0,0 +1,62 @@
+#define JLIB_IMPLEMENTATION
+#include <jlib/jlib_all.h>
+
+#include <fstream>
+
+// bench_jlib [--perf] [--json=path] [--csv=path] [name filters...]
+// bench_jlib --compare baseline.json current.json [--threshold=0.05] [--alpha=0.01]
+//     exits with 1 if any benchmark regressed or is missing from the current run
+int main(int argc, char* argv[]) {
+    auto options = bench_options {};
+    auto compare = bench_compare_options {};
+    auto filters = std::vector<std::string_view> {};
+    auto json_path = std::string {};
+    auto csv_path = std::string {};
+    auto compare_mode = false;
+    auto value = [](std::string_view arg) {
+        return std::string { arg.substr(arg.find('=') + 1) };
+    };
+    for (auto arg : std::vector<std::string_view> { argv + 1, argv + argc }) {
+        if (arg == "--perf") {
+            options.counters = true;
+        } else if (arg == "--compare") {
+            compare_mode = true;
+        } else if (arg.starts_with("--json=")) {
+            json_path = value(arg);
+        } else if (arg.starts_with("--csv=")) {
+            csv_path = value(arg);
+        } else if (arg.starts_with("--threshold=")) {
+            compare.threshold = std::stod(value(arg));
+        } else if (arg.starts_with("--alpha=")) {
+            compare.alpha = std::stod(value(arg));
+        } else {
+            filters.push_back(arg);
+        }
+    }
+
+    if (compare_mode) {
+        if (filters.size() != 2) {
+            log("usage: bench_jlib --compare baseline.json current.json");
+            return 2;
+        }
+        auto baseline_file = std::ifstream { std::string { filters[0] } };
+        auto current_file = std::ifstream { std::string { filters[1] } };
+        if (!baseline_file || !current_file) {
+            log("can't open", filters[0], "or", filters[1]);
+            return 2;
+        }
+        const auto failures = log_bench_comparison(compare_benchmarks(read_bench_json(baseline_file), read_bench_json(current_file), compare));
+        return failures ? 1 : 0;
+    }
+
+    const auto results = run_benchmarks(filters, options);
+    if (json_path.size()) {
+        auto out = std::ofstream { json_path };
+        write_bench_json(out, results);
+    }
+    if (csv_path.size()) {
+        auto out = std::ofstream { csv_path };
+        write_bench_csv(out, results);
+    }
+    return 0;
+}
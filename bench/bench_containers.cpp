@@ -0,0 +1,342 @@
+// bench_containers.cpp
+// every jlib container under realistic workloads, to pick one per use case
+// names are "<group> <container> <key> <size> <workload> <distribution>", filter with any substring:
+//     ./bench_jlib "map hash_map<u64> 256K"
+//     ./bench_jlib zipf
+
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std::literals;
+
+#include <jlib/bench_framework.h>
+#include <jlib/fixed_pool.h>
+#include <jlib/hash_map.h>
+#include <jlib/hash_table.h>
+#include <jlib/heapsort.h>
+#include <jlib/static_stack.h>
+#include <jlib/swiss_vector.h>
+
+#include "workload.h"
+
+// element counts chosen so the containers roughly fit in L1, L2, the LLC, and spill past it
+static const size_t MAP_SIZES[] = { 1 << 10, 1 << 14, 1 << 18, 1 << 22 };
+static const char* const MAP_SIZE_LEVEL[] = { "L1", "L2", "LLC", "DRAM" };
+static const size_t OPS_PER_ITERATION = 1 << 14;
+
+static const workload_mix MIXES[] = {
+    { "read-hit", 100, 0, 0, 0 },
+    { "read-miss", 100, 0, 0, 90 },
+    { "mixed-80/10/10", 80, 10, 10, 10 },
+    { "write-heavy-20/40/40", 20, 40, 40, 0 },
+};
+
+// maps
+
+template<typename Key> struct map_fixture_keys {
+    std::vector<Key> keys; // 2n, see workload.h
+    std::vector<workload_entry> ops;
+};
+
+template<typename Map, typename Key> struct map_fixture {
+    map_fixture_keys<Key> input;
+    Map map;
+};
+
+template<typename Key> static std::vector<Key> make_keys(size_t n) {
+    if constexpr (std::is_same_v<Key, std::string>) {
+        return workload_string_keys(n);
+    } else {
+        return workload_int_keys(n);
+    }
+}
+
+template<typename Map, typename Key>
+static void map_workload(bench_state& state, const std::string& name, size_t n, workload_mix mix, key_dist dist) {
+    using fixture = map_fixture<Map, Key>;
+    auto& f = workload_fixture<fixture>(name, [&] {
+        auto r = fixture {};
+        // presized for n at most half full; hash_map only grows once it runs out of free buckets
+        r.map = Map(int(2 * n));
+        r.input.keys = make_keys<Key>(2 * n);
+        r.input.ops = workload_ops(n, OPS_PER_ITERATION, mix, dist);
+        for (auto i = size_t { 0 }; i < n; i++) {
+            r.map.insert_or_assign(r.input.keys[i], r.input.keys[i]);
+        }
+        return r;
+    });
+    state.set_items_per_iteration(f.input.ops.size());
+    for (auto _ : state) {
+        auto found = size_t { 0 };
+        for (auto& e : f.input.ops) {
+            const auto& key = f.input.keys[e.key];
+            switch (e.op) {
+            case workload_op::read:
+                found += f.map.contains(key);
+                break;
+            case workload_op::insert:
+                f.map.insert_or_assign(key, key);
+                break;
+            case workload_op::erase:
+                f.map.erase(key);
+                break;
+            }
+        }
+        do_not_optimize(found);
+    }
+}
+
+template<typename Map, typename Key> static void register_map(std::string_view map_name, std::string_view key_name, size_t max_size) {
+    for (auto s = size_t { 0 }; s < std::size(MAP_SIZES); s++) {
+        const auto n = MAP_SIZES[s];
+        if (n > max_size) {
+            continue;
+        }
+        for (auto& mix : MIXES) {
+            for (auto dist : { key_dist::uniform, key_dist::zipf }) {
+                auto name = "map "s + std::string { map_name } + "<" + std::string { key_name } + "> " + workload_size_name(n) + " "
+                          + MAP_SIZE_LEVEL[s] + " " + mix.name + " " + std::string { key_dist_name(dist) };
+                bench_register(name, [=](bench_state& state) { map_workload<Map, Key>(state, name, n, mix, dist); });
+            }
+        }
+    }
+}
+
+static auto maps_registered = [] {
+    register_map<std::unordered_map<uint64_t, uint64_t>, uint64_t>("std::unordered_map", "u64", SIZE_MAX);
+    register_map<hash_map<uint64_t, uint64_t>, uint64_t>("hash_map", "u64", SIZE_MAX);
+    register_map<hash_table<uint64_t, uint64_t>, uint64_t>("hash_table", "u64", SIZE_MAX);
+    // string keys are ~40 bytes a key and value, stop short of the largest size
+    register_map<std::unordered_map<std::string, std::string>, std::string>("std::unordered_map", "str12", 1 << 18);
+    register_map<hash_map<std::string, std::string>, std::string>("hash_map", "str12", 1 << 18);
+    register_map<hash_table<std::string, std::string>, std::string>("hash_table", "str12", 1 << 18);
+    return true;
+}();
+
+// priority queues, hold model: pop the top, push a new random key
+
+static const size_t HEAP_SIZES[] = { 1 << 10, 1 << 14, 1 << 18, 1 << 22 };
+
+template<typename Heap> static void heap_hold(bench_state& state, const std::string& name, size_t n) {
+    struct fixture {
+        Heap heap;
+        std::vector<uint64_t> pushes;
+    };
+    auto& f = workload_fixture<fixture>(name, [&] {
+        auto r = fixture {};
+        auto keys = workload_int_keys(n + OPS_PER_ITERATION);
+        for (auto i = size_t { 0 }; i < n; i++) {
+            r.heap.push(keys[i]);
+        }
+        r.pushes.assign(keys.begin() + n, keys.end());
+        return r;
+    });
+    state.set_items_per_iteration(f.pushes.size());
+    for (auto _ : state) {
+        auto sum = uint64_t { 0 };
+        for (auto k : f.pushes) {
+            sum += f.heap.top();
+            f.heap.pop();
+            f.heap.push(k);
+        }
+        do_not_optimize(sum);
+    }
+}
+
+template<typename Heap> static void register_heap(std::string_view heap_name) {
+    for (auto n : HEAP_SIZES) {
+        auto name = "heap "s + std::string { heap_name } + " " + workload_size_name(n) + " hold";
+        bench_register(name, [=](bench_state& state) { heap_hold<Heap>(state, name, n); });
+    }
+}
+
+static auto heaps_registered = [] {
+    register_heap<std::priority_queue<uint64_t>>("std::priority_queue");
+    register_heap<dynamic_heap<uint64_t, std::less<uint64_t>, 2>>("dynamic_heap<arity 2>");
+    register_heap<dynamic_heap<uint64_t, std::less<uint64_t>, 4>>("dynamic_heap<arity 4>");
+    register_heap<dynamic_heap<uint64_t, std::less<uint64_t>, 8>>("dynamic_heap<arity 8>");
+    return true;
+}();
+
+// slot containers: churn (remove a random live element, add one) and iteration at half occupancy
+
+struct pool_item {
+    uint64_t id;
+    float position[3];
+    float velocity[3];
+};
+
+static const size_t POOL_SIZES[] = { 1 << 8, 1 << 12, 1 << 16, 1 << 20 };
+
+// uniform interface over the containers: add returns the slot index
+struct pool_vector_adapter {
+    std::vector<pool_item> items;
+    explicit pool_vector_adapter(size_t capacity) {
+        items.reserve(capacity);
+    }
+    size_t add(uint64_t id) {
+        items.push_back({ id, {}, {} });
+        return items.size() - 1;
+    }
+    // swap and pop: moves the last element into the slot, so indices change
+    void remove(size_t index) {
+        items[index] = items.back();
+        items.pop_back();
+    }
+    template<typename F> void for_each(F&& f) {
+        for (auto& i : items) {
+            f(i);
+        }
+    }
+    static constexpr bool stable_indices = false;
+};
+
+struct swiss_vector_adapter {
+    swiss_vector<pool_item> items;
+    explicit swiss_vector_adapter(size_t capacity) {
+        items.reserve(capacity);
+    }
+    size_t add(uint64_t id) {
+        auto& item = items.emplace_back(pool_item { id, {}, {} });
+        return size_t(&item - items.data());
+    }
+    void remove(size_t index) {
+        items.remove(index);
+    }
+    template<typename F> void for_each(F&& f) {
+        for (auto& i : items) {
+            f(i);
+        }
+    }
+    static constexpr bool stable_indices = true;
+};
+
+struct fixed_pool_adapter {
+    fixed_pool<pool_item> items;
+    explicit fixed_pool_adapter(size_t capacity): items(capacity) {}
+    size_t add(uint64_t id) {
+        auto& item = items.add(pool_item { id, {}, {} });
+        return size_t(&item - items.get_storage().data());
+    }
+    void remove(size_t index) {
+        items.remove(items.get_storage()[index]);
+    }
+    template<typename F> void for_each(F&& f) {
+        for (auto& i : items) {
+            f(i);
+        }
+    }
+    static constexpr bool stable_indices = true;
+};
+
+template<typename Pool> struct pool_fixture {
+    Pool pool;
+    std::vector<size_t> live; // slot indices for stable pools, positions otherwise
+    std::vector<uint32_t> victims; // indices into live
+};
+
+// fill to n, then remove every other element so iteration skips holes
+template<typename Pool> static pool_fixture<Pool> make_pool(size_t n) {
+    auto f = pool_fixture<Pool> { Pool { n }, {}, {} };
+    for (auto i = size_t { 0 }; i < n; i++) {
+        f.pool.add(i);
+    }
+    if constexpr (Pool::stable_indices) {
+        for (auto i = size_t { 0 }; i < n; i++) {
+            if (i % 2) {
+                f.pool.remove(i);
+            } else {
+                f.live.push_back(i);
+            }
+        }
+    } else {
+        for (auto i = n / 2; i > 0; i--) {
+            f.pool.remove(i - 1);
+        }
+        for (auto i = size_t { 0 }; i < n / 2; i++) {
+            f.live.push_back(i);
+        }
+    }
+    auto rng = std::mt19937 { 7 };
+    auto pick = std::uniform_int_distribution<uint32_t> { 0, uint32_t(f.live.size() - 1) };
+    f.victims.resize(OPS_PER_ITERATION);
+    for (auto& v : f.victims) {
+        v = pick(rng);
+    }
+    return f;
+}
+
+template<typename Pool> static void pool_churn(bench_state& state, const std::string& name, size_t n) {
+    auto& f = workload_fixture<pool_fixture<Pool>>(name, [&] { return make_pool<Pool>(n); });
+    state.set_items_per_iteration(f.victims.size());
+    for (auto _ : state) {
+        for (auto v : f.victims) {
+            f.pool.remove(f.live[v]);
+            const auto slot = f.pool.add(v);
+            if constexpr (Pool::stable_indices) {
+                f.live[v] = slot;
+            }
+        }
+        clobber_memory();
+    }
+}
+
+template<typename Pool> static void pool_iterate(bench_state& state, const std::string& name, size_t n) {
+    auto& f = workload_fixture<pool_fixture<Pool>>(name, [&] { return make_pool<Pool>(n); });
+    state.set_items_per_iteration(f.live.size());
+    for (auto _ : state) {
+        // read only, fixed_pool iterates const elements
+        auto sum = 0.0f;
+        f.pool.for_each([&](const pool_item& i) {
+            for (auto d = 0; d < 3; d++) {
+                sum += i.position[d] * i.velocity[d];
+            }
+        });
+        do_not_optimize(sum);
+    }
+}
+
+template<typename Pool> static void register_pool(std::string_view pool_name) {
+    for (auto n : POOL_SIZES) {
+        auto prefix = "pool "s + std::string { pool_name } + " " + workload_size_name(n);
+        bench_register(prefix + " churn", [=, name = prefix + " churn"](bench_state& state) { pool_churn<Pool>(state, name, n); });
+        bench_register(prefix + " iterate", [=, name = prefix + " iterate"](bench_state& state) { pool_iterate<Pool>(state, name, n); });
+    }
+}
+
+static auto pools_registered = [] {
+    register_pool<pool_vector_adapter>("std::vector(swap-remove)");
+    register_pool<swiss_vector_adapter>("swiss_vector");
+    register_pool<fixed_pool_adapter>("fixed_pool");
+    return true;
+}();
+
+// stacks: fill to depth then drain
+
+template<typename Stack> static void stack_fill_drain(bench_state& state, Stack& stack, size_t depth) {
+    state.set_items_per_iteration(depth);
+    for (auto _ : state) {
+        for (auto i = size_t { 0 }; i < depth; i++) {
+            stack.push_back(i);
+        }
+        auto sum = uint64_t { 0 };
+        for (auto i = size_t { 0 }; i < depth; i++) {
+            sum += stack[stack.size() - 1];
+            stack.pop_back();
+        }
+        do_not_optimize(sum);
+    }
+}
+
+BENCH("stack static_stack 1K fill-drain") {
+    auto stack = static_stack<uint64_t, 1024> {};
+    stack_fill_drain(state, stack, 1024);
+}
+BENCH("stack std::vector(reserved) 1K fill-drain") {
+    auto stack = std::vector<uint64_t> {};
+    stack.reserve(1024);
+    stack_fill_drain(state, stack, 1024);
+}
@@ -0,0 +1,96 @@
+// bench_hash_map.cpp
+
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+namespace chrono = std::chrono;
+using namespace std::literals;
+
+#include <jlib/bench_framework.h>
+#include <jlib/hash_map.h>
+#include <jlib/hash_table.h>
+
+
+static_assert(bench_type_name<int>() == "int"sv);
+static_assert(bench_type_name<std::vector<char>>() == "std::vector<char>"sv);
+
+
+static const auto TESTSIZE = 100'000;
+
+
+#define STRINGBENCH
+#ifdef STRINGBENCH
+using TestType = std::string;
+static auto S() {
+    auto s = std::string(100, 'A');
+    for (auto& c: s) {
+        c = char('A' + rand() % 26);
+    }
+    return s;
+}
+#else
+using TestType = int;
+static auto S() {
+    return rand();
+}
+#endif
+using UM = std::unordered_map<TestType, TestType>;
+using HM = hash_map<TestType, TestType>;
+using HT = hash_table<TestType, TestType>;
+static auto KEYS = std::vector<TestType> {};
+void init_keys() {
+    if (KEYS.size()) {
+        return;
+    }
+    for (auto i = 0; i < TESTSIZE; i++) {
+        KEYS.emplace_back(S());
+    }
+}
+
+
+
+template<typename Map> static void inserts(bench_state& state) {
+    init_keys();
+    state.set_items_per_iteration(TESTSIZE);
+    for (auto _ : state) {
+        state.pause_timing();
+        auto map = Map {};
+        srand(12345);
+        state.resume_timing();
+        for (auto i = 0; i < TESTSIZE; i++) {
+            auto k = KEYS[rand() % KEYS.size()];
+            map.insert_or_assign(k, k);
+        }
+        do_not_optimize(map);
+    }
+}
+
+template<typename Map> static void reads(bench_state& state) {
+    init_keys();
+    auto map = Map {};
+    srand(23456);
+    for (auto i = 0; i < TESTSIZE; i++) {
+        auto k = KEYS[rand() % KEYS.size()];
+        auto v = KEYS[rand() % KEYS.size()];
+        map.insert_or_assign(k, v);
+    }
+    state.set_items_per_iteration(TESTSIZE);
+    for (auto _ : state) {
+        auto found = 0;
+        for (auto i = 0; i < TESTSIZE; i++) {
+            if (map.contains(KEYS[rand() % KEYS.size()])) {
+                found++;
+            }
+        }
+        do_not_optimize(found);
+    }
+}
+
+template<typename... Maps> static bool register_map_benches() {
+    (bench_register("100k inserts "s + std::string { bench_type_name<Maps>() }, inserts<Maps>), ...);
+    (bench_register("100k reads "s + std::string { bench_type_name<Maps>() }, reads<Maps>), ...);
+    return true;
+}
+static auto registered = register_map_benches<UM, HM, HT>();
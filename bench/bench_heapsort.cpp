@@ -0,0 +1,45 @@
+// bench_heapsort.cpp
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <jlib/bench_framework.h>
+#include <jlib/heapsort.h>
+#include <jlib/parallel_sort.h>
+
+static const auto SORTSIZE = 2'000'000;
+
+static const std::vector<uint64_t>& random_data() {
+    static const auto data = [] {
+        srand(34567);
+        auto d = std::vector<uint64_t>(SORTSIZE);
+        for (auto& x : d) {
+            x = (uint64_t(rand()) << 32) | rand();
+        }
+        return d;
+    }();
+    return data;
+}
+
+template<typename F> static void bench_sort(bench_state& state, F&& f) {
+    auto data = std::vector<uint64_t> {};
+    state.set_items_per_iteration(SORTSIZE);
+    for (auto _ : state) {
+        state.pause_timing();
+        data = random_data();
+        state.resume_timing();
+        f(data);
+        clobber_memory();
+    }
+}
+
+BENCH("sort 2M std::sort") {
+    bench_sort(state, [](auto& d) { std::sort(d.begin(), d.end()); });
+}
+BENCH("sort 2M heapsort in-place") {
+    bench_sort(state, [](auto& d) { heapsort(d.begin(), d.end(), std::less<> {}); });
+}
+BENCH("sort 2M parallel_sort") {
+    bench_sort(state, [](auto& d) { parallel_sort(d.begin(), d.end(), std::less<> {}); });
+}
@@ -0,0 +1,101 @@
+// bench_text_file.cpp
+// line by line reads of a 64MB log-like file: getline into a std::string vs mapped, chunked and parallel string_view lines
+// and the line splitting on its own
+// the file stays in the page cache between samples, so this measures line splitting rather than the disk
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <jlib/bench_framework.h>
+#include <jlib/text_file.h>
+
+#include "workload.h"
+
+static const auto TEXT_SIZE = size_t { 64 } << 20;
+
+// lines of 20 to 200 characters, like a typical log
+static const std::filesystem::path& text_path() {
+    static const auto path = [] {
+        auto p = std::filesystem::temp_directory_path() / "jlib_bench_text.log";
+        auto text = std::string {};
+        text.reserve(TEXT_SIZE + 256);
+        for (auto i = uint64_t { 0 }; text.size() < TEXT_SIZE; i++) {
+            const auto x = workload_scramble(i);
+            text.append(20 + x % 180, char('a' + x % 26));
+            text += '\n';
+        }
+        write_text_file(p, text);
+        return p;
+    }();
+    return path;
+}
+
+template<typename F> static void bench_lines(bench_state& state, F&& read) {
+    const auto& path = text_path();
+    state.set_items_per_iteration(TEXT_SIZE);
+    for (auto _ : state) {
+        auto bytes = size_t { 0 };
+        read(path, [&](const auto& line) -> bool {
+            bytes += line.size() + 1;
+            return true;
+        });
+        do_not_optimize(bytes);
+    }
+}
+
+BENCH("text_file 64M lines getline") {
+    bench_lines(state, [](auto& path, auto callback) { read_text_file(path, [&](const std::string& line) { return callback(line); }); });
+}
+BENCH("text_file 64M lines mapped") {
+    bench_lines(state, [](auto& path, auto callback) { read_text_file_mapped(path, [&](std::string_view line) { return callback(line); }); });
+}
+BENCH("text_file 64M lines chunked") {
+    bench_lines(state, [](auto& path, auto callback) { read_text_file_chunked(path, [&](std::string_view line) { return callback(line); }); });
+}
+BENCH("text_file 64M lines parallel") {
+    const auto& path = text_path();
+    state.set_items_per_iteration(TEXT_SIZE);
+    for (auto _ : state) {
+        auto bytes = std::atomic<size_t> { 0 };
+        read_text_file_parallel(path, [&](std::string_view line) {
+            bytes.fetch_add(line.size() + 1, std::memory_order_relaxed);
+            return true;
+        });
+        do_not_optimize(bytes);
+    }
+}
+
+// splitting alone, on text already in memory
+template<typename F> static void bench_split(bench_state& state, F&& split) {
+    static const auto text = [] {
+        auto t = std::string {};
+        read_text_file(text_path(), t);
+        return t;
+    }();
+    state.set_items_per_iteration(text.size());
+    for (auto _ : state) {
+        auto bytes = size_t { 0 };
+        split(std::string_view { text }, [&](std::string_view line) {
+            bytes += line.size() + 1;
+            return true;
+        });
+        do_not_optimize(bytes);
+    }
+}
+
+BENCH("text_file 64M split string_view::find") {
+    bench_split(state, [](std::string_view text, auto callback) {
+        for (auto start = size_t { 0 }; start < text.size();) {
+            auto end = std::min(text.find('\n', start), text.size());
+            callback(text.substr(start, end - start));
+            start = end + 1;
+        }
+    });
+}
+BENCH("text_file 64M split split_lines") {
+    bench_split(state, [](std::string_view text, auto callback) { split_lines(text, callback); });
+}
@@ -0,0 +1,162 @@
+// workload.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+workload generation for the container benchmarks
+
+    - keys: distinct random integers, or short strings that fit in the small string buffer
+    - key universes are 2n keys: [0, n) get inserted up front, [n, 2n) are never inserted,
+        so lookups into the upper half are guaranteed misses
+    - key_dist::zipf draws ranks with P(rank k) ~ 1 / (k + 1)^s, a few hot keys and a long tail
+    - op streams are generated up front so the timed loop only runs container code
+*/
+
+// a bijection on uint64_t, so distinct inputs give distinct well-mixed keys
+constexpr uint64_t workload_scramble(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+inline std::vector<uint64_t> workload_int_keys(size_t n) {
+    auto keys = std::vector<uint64_t>(n);
+    for (auto i = size_t { 0 }; i < n; i++) {
+        keys[i] = workload_scramble(i);
+    }
+    return keys;
+}
+
+// 12 characters, within libstdc++'s 15 and libc++'s 22 byte small string buffers
+inline std::vector<std::string> workload_string_keys(size_t n) {
+    static constexpr char digits[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    auto keys = std::vector<std::string>(n);
+    for (auto i = size_t { 0 }; i < n; i++) {
+        auto x = workload_scramble(i);
+        auto& k = keys[i];
+        k.resize(12);
+        for (auto& c : k) {
+            c = digits[x % 62];
+            x /= 62;
+        }
+    }
+    return keys;
+}
+
+class zipf_distribution {
+public:
+    explicit zipf_distribution(size_t n, double s = 0.99): cdf(n) {
+        auto sum = 0.0;
+        for (auto k = size_t { 0 }; k < n; k++) {
+            sum += 1.0 / std::pow(double(k + 1), s);
+            cdf[k] = sum;
+        }
+        for (auto& c : cdf) {
+            c /= sum;
+        }
+    }
+
+    template<typename Rng> size_t operator()(Rng& rng) {
+        const auto u = std::uniform_real_distribution<double> { 0.0, 1.0 }(rng);
+        const auto i = size_t(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        return std::min(i, cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+enum class key_dist { uniform, zipf };
+
+inline std::string_view key_dist_name(key_dist d) {
+    return d == key_dist::uniform ? "uniform" : "zipf";
+}
+
+enum class workload_op : uint8_t { read, insert, erase };
+
+struct workload_entry {
+    workload_op op;
+    uint32_t key; // index into the 2n key universe
+};
+
+// percentages of each operation; miss is the share of reads aimed at absent keys
+struct workload_mix {
+    const char* name;
+    int read;
+    int insert;
+    int erase;
+    int miss = 0;
+};
+
+// inserts and erases are drawn from the same n keys, so mixed workloads settle into a
+// steady state instead of growing or draining the container
+inline std::vector<workload_entry> workload_ops(size_t n, size_t count, workload_mix mix, key_dist dist, uint64_t seed = 1) {
+    auto rng = std::mt19937_64 { seed };
+    auto zipf = std::unique_ptr<zipf_distribution> {};
+    if (dist == key_dist::zipf) {
+        zipf = std::make_unique<zipf_distribution>(n);
+    }
+    auto uniform = std::uniform_int_distribution<size_t> { 0, n - 1 };
+    auto percent = std::uniform_int_distribution<int> { 0, 99 };
+    auto pick = [&] {
+        return zipf ? (*zipf)(rng) : uniform(rng);
+    };
+
+    auto ops = std::vector<workload_entry>(count);
+    for (auto& e : ops) {
+        const auto p = percent(rng);
+        if (p < mix.read) {
+            e.op = workload_op::read;
+            e.key = uint32_t(percent(rng) < mix.miss ? n + pick() : pick());
+        } else if (p < mix.read + mix.insert) {
+            e.op = workload_op::insert;
+            e.key = uint32_t(pick());
+        } else {
+            e.op = workload_op::erase;
+            e.key = uint32_t(pick());
+        }
+    }
+    return ops;
+}
+
+// "1K", "256K", "4M"
+inline std::string workload_size_name(size_t n) {
+    if (n >= (1 << 20) && n % (1 << 20) == 0) {
+        return std::to_string(n >> 20) + "M";
+    }
+    if (n >= (1 << 10) && n % (1 << 10) == 0) {
+        return std::to_string(n >> 10) + "K";
+    }
+    return std::to_string(n);
+}
+
+// fixtures are expensive to build at the larger sizes, and a benchmark body runs once per sample
+// keep the most recent one alive, keyed by benchmark name, and free it when the next benchmark starts
+struct workload_fixture_slot {
+    std::string name;
+    std::shared_ptr<void> fixture;
+
+    static workload_fixture_slot& get() {
+        static auto slot = workload_fixture_slot {};
+        return slot;
+    }
+};
+
+template<typename T, typename Make> T& workload_fixture(const std::string& name, Make&& make) {
+    auto& slot = workload_fixture_slot::get();
+    if (slot.name != name || !slot.fixture) {
+        slot.fixture.reset();
+        slot.fixture = std::make_shared<T>(make());
+        slot.name = name;
+    }
+    return *static_cast<T*>(slot.fixture.get());
+}
@@ -0,0 +1,8 @@
+// fuzz_hash_map.cpp
+// coverage-guided: hash_map against std::unordered_map, see fuzz/CMakeLists.txt
+
+#include <fuzz/fuzz_models.h>
+#include <jlib/hash_map.h>
+
+using model = map_model<hash_map<uint32_t, uint32_t>>;
+JLIB_FUZZ_TARGET(model)
@@ -0,0 +1,8 @@
+// fuzz_hash_table.cpp
+// coverage-guided: hash_table against std::unordered_map, see fuzz/CMakeLists.txt
+
+#include <fuzz/fuzz_models.h>
+#include <jlib/hash_table.h>
+
+using model = map_model<hash_table<uint32_t, uint32_t>>;
+JLIB_FUZZ_TARGET(model)
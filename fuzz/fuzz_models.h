@@ -0,0 +1,93 @@
+// fuzz_models.h
+// differential models for the jlib containers, shared by test/test_fuzz.cpp and the libFuzzer targets
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <jlib/fuzz.h>
+#include <jlib/swiss_vector.h>
+
+// keys are kept to a small range so inserts, erases and lookups keep colliding
+template<typename Map> struct map_model {
+    static constexpr uint8_t op_count = 4;
+    Map subject;
+    std::unordered_map<uint32_t, uint32_t> reference;
+
+    void apply(const fuzz_op& op) {
+        const auto key = op.a % 1024;
+        switch (op.code) {
+        case 0:
+            subject.insert_or_assign(key, op.b);
+            reference.insert_or_assign(key, op.b);
+            break;
+        case 1:
+            subject.erase(key);
+            reference.erase(key);
+            break;
+        case 2:
+            FUZZ_CHECK(subject.contains(key) == reference.contains(key));
+            break;
+        case 3:
+            if (reference.contains(key)) {
+                FUZZ_CHECK(subject.at(key) == reference.at(key));
+            }
+            break;
+        }
+        FUZZ_CHECK(size_t(subject.size()) == reference.size());
+    }
+    void check() const {
+        for (auto& [k, v] : reference) {
+            FUZZ_CHECK(subject.contains(k) && subject.at(k) == v);
+        }
+    }
+    static std::string describe(const fuzz_op& op) {
+        static constexpr const char* names[] = { "insert_or_assign", "erase", "contains", "at" };
+        return std::string { names[op.code] } + "(" + std::to_string(op.a) + (op.code ? ")" : ", " + std::to_string(op.b) + ")");
+    }
+};
+
+// slots handed out by emplace_back are stable, so compare against index -> value
+struct swiss_vector_model {
+    static constexpr uint8_t op_count = 3;
+    swiss_vector<uint32_t> subject;
+    std::map<size_t, uint32_t> reference;
+
+    void apply(const fuzz_op& op) {
+        switch (op.code) {
+        case 0: {
+            const auto index = size_t(&subject.emplace_back(op.b) - subject.data());
+            FUZZ_CHECK(!reference.contains(index));
+            reference[index] = op.b;
+            break;
+        }
+        case 1:
+            if (op.a < subject.capacity()) {
+                subject.remove(op.a);
+                reference.erase(op.a);
+            }
+            break;
+        case 2:
+            if (op.a % 16 == 0) {
+                subject.clear();
+                reference.clear();
+            }
+            break;
+        }
+        FUZZ_CHECK(subject.size() == reference.size());
+    }
+    void check() const {
+        auto values = std::vector<uint32_t> {};
+        for (auto it = subject.cbegin(); it != subject.cend(); ++it) {
+            values.push_back(*it);
+        }
+        auto expected = std::vector<uint32_t> {};
+        for (auto& [_, v] : reference) {
+            expected.push_back(v);
+        }
+        FUZZ_CHECK(values == expected);
+    }
+};
@@ -0,0 +1,6 @@
+// fuzz_swiss_vector.cpp
+// coverage-guided: swiss_vector against std::map, see fuzz/CMakeLists.txt
+
+#include <fuzz/fuzz_models.h>
+
+JLIB_FUZZ_TARGET(swiss_vector_model)
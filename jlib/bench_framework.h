@@ -0,0 +1,435 @@
+// bench_framework.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "log.h"
+#include "perf_counters.h"
+
+#ifndef paste
+#define paste(a, b) a##b
+#endif
+
+/*
+microbenchmark framework
+
+usage:
+
+    BENCH("vector push_back") {
+        // setup here is not timed
+        auto v = std::vector<int> {};
+        for (auto _ : state) {
+            v.push_back(1);
+            do_not_optimize(v.data());
+        }
+    }
+
+    - the body receives a bench_state& named state, the timed region is the range-for over it
+        use state.pause_timing() / state.resume_timing() for per-iteration setup inside the loop
+    - each benchmark is warmed up, then the iteration count is calibrated so one sample takes
+        about bench_options::sample_time, then bench_options::samples samples are taken
+        (fewer if a single iteration is so slow they would take longer than max_time)
+    - reported per iteration: median, median absolute deviation, a distribution-free 95%
+        confidence interval for the median, min, max
+        differences whose confidence intervals overlap are noise
+    - with bench_options::counters (bench_jlib --perf), hardware counters from perf_counters.h
+        are read around the timed region and reported per item, Linux only
+    - do_not_optimize(x) forces x to be computed, clobber_memory() forces pending writes out
+    - bench_register(name, f) registers at runtime, e.g. one benchmark per template argument
+    - benchmarks live in the bench/ directory and build into the bench_jlib executable,
+        call run_benchmarks() from main, see bench/bench.cpp
+*/
+
+// optimization barriers
+template<typename T> inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const auto* volatile sink = &value;
+    (void)sink;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+template<typename T> inline void do_not_optimize(T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+m"(value) : : "memory");
+#else
+    auto* volatile sink = &value;
+    (void)sink;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// "int", "std::vector<char>", for naming benchmarks per template argument
+template<typename T> constexpr std::string_view bench_type_name() {
+#if defined(__clang__) || defined(__GNUC__)
+    // clang: "... bench_type_name() [T = int]"
+    // gcc:   "... bench_type_name() [with T = int; std::string_view = ...]"
+    constexpr auto fn = std::string_view { __PRETTY_FUNCTION__ };
+    constexpr auto a = fn.find("T = ") + 4;
+    constexpr auto b = fn.find_first_of(";]", a);
+    return fn.substr(a, b - a);
+#else
+    // msvc: "... bench_type_name<int>(void)"
+    constexpr auto fn = std::string_view { __FUNCSIG__ };
+    constexpr auto a = fn.find("bench_type_name<") + 16;
+    constexpr auto b = fn.rfind(">(void)");
+    return fn.substr(a, b - a);
+#endif
+}
+
+struct bench_options {
+    std::chrono::nanoseconds warmup = std::chrono::milliseconds(100);
+    std::chrono::nanoseconds sample_time = std::chrono::milliseconds(10);
+    size_t samples = 30;
+    // slow benchmarks stop sampling after this long, once they have min_samples
+    std::chrono::nanoseconds max_time = std::chrono::seconds(10);
+    size_t min_samples = 5;
+    // read hardware performance counters around the timed region
+    bool counters = false;
+};
+
+class bench_state {
+    using clock = std::chrono::steady_clock;
+
+public:
+    explicit bench_state(uint64_t iterations, perf_counters* counters = nullptr): iterations_(iterations), counters(counters) {}
+
+    struct sentinel {};
+    // marked so `for (auto _ : state)` doesn't warn
+    struct [[maybe_unused]] value {};
+    struct iterator {
+        bench_state* state;
+        uint64_t remaining;
+
+        bool operator!=(sentinel) {
+            if (remaining) {
+                return true;
+            }
+            state->stop();
+            return false;
+        }
+        void operator++() {
+            remaining--;
+        }
+        value operator*() const {
+            return {};
+        }
+    };
+
+    iterator begin() {
+        start();
+        return { this, iterations_ };
+    }
+    sentinel end() {
+        return {};
+    }
+
+    void pause_timing() {
+        elapsed += clock::now() - started;
+        if (counters) {
+            counters->stop();
+        }
+    }
+    void resume_timing() {
+        if (counters) {
+            counters->start();
+        }
+        started = clock::now();
+    }
+
+    uint64_t iterations() const {
+        return iterations_;
+    }
+    // e.g. elements touched per iteration, reported as time per item
+    void set_items_per_iteration(uint64_t n) {
+        items = n;
+    }
+    uint64_t items_per_iteration() const {
+        return items;
+    }
+    std::chrono::nanoseconds elapsed_time() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+    }
+    // false if the body never looped over the state, or broke out of the loop early
+    bool completed() const {
+        return completed_;
+    }
+
+private:
+    void start() {
+        elapsed = {};
+        if (counters) {
+            counters->reset();
+            counters->start();
+        }
+        started = clock::now();
+    }
+    void stop() {
+        completed_ = true;
+        elapsed += clock::now() - started;
+        if (counters) {
+            counters->stop();
+        }
+    }
+
+    uint64_t iterations_;
+    uint64_t items = 0;
+    perf_counters* counters;
+    clock::time_point started;
+    clock::duration elapsed = {};
+    bool completed_ = false;
+};
+
+struct bench_result {
+    std::string name;
+    std::string error; // set if the benchmark couldn't be timed, the rest is then empty
+    uint64_t iterations = 0; // per sample
+    uint64_t items_per_iteration = 0;
+    std::vector<double> samples; // ns per iteration, sorted
+    double median = 0;
+    double mad = 0; // median absolute deviation
+    double ci_low = 0; // 95% confidence interval of the median
+    double ci_high = 0;
+    double mean = 0;
+    double min = 0;
+    double max = 0;
+    // hardware counters per iteration over all samples, negative if not measured
+    std::array<double, size_t(perf_event::count)> counters = { -1, -1, -1, -1 };
+
+    bool has_counters() const {
+        return counters[0] >= 0;
+    }
+};
+
+struct bench_case {
+    std::string name;
+    std::function<void(bench_state&)> func;
+};
+
+std::vector<bench_case>& ALL_BENCHES();
+
+inline bool bench_register(std::string name, std::function<void(bench_state&)> f) {
+    ALL_BENCHES().push_back({ std::move(name), std::move(f) });
+    return true;
+}
+
+// statistics over samples (sorted in place)
+void bench_summarize(bench_result& result);
+
+// time one benchmark
+bench_result run_bench(const bench_case& bench, const bench_options& options = {});
+
+// run every benchmark whose name contains one of the filters (all if empty), logging as they go
+// benchmarks that report an error are logged and left out of the results
+std::vector<bench_result> run_benchmarks(const std::vector<std::string_view>& filters = {}, const bench_options& options = {});
+
+// "12.3ns", "4.56ms"
+std::string bench_format_time(double ns);
+
+#define BENCH_(counter, name)                                                                      \
+    static void paste(__bench_func_, counter)(bench_state & state);                                \
+    static auto paste(__bench_, counter) = bench_register(name, &paste(__bench_func_, counter));   \
+    static void paste(__bench_func_, counter)([[maybe_unused]] bench_state & state)
+#define BENCH(name) BENCH_(__COUNTER__, name)
+
+#ifdef JLIB_IMPLEMENTATION
+
+std::vector<bench_case>& ALL_BENCHES() {
+    static auto all_benches = std::vector<bench_case> {};
+    return all_benches;
+}
+
+static double bench_median(const std::vector<double>& sorted) {
+    const auto n = sorted.size();
+    if (n == 0) {
+        return 0;
+    }
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+void bench_summarize(bench_result& r) {
+    auto& s = r.samples;
+    if (s.empty()) {
+        return;
+    }
+    std::sort(s.begin(), s.end());
+    const auto n = s.size();
+    r.median = bench_median(s);
+    r.min = s.front();
+    r.max = s.back();
+    auto sum = 0.0;
+    auto deviations = std::vector<double> {};
+    for (auto x : s) {
+        sum += x;
+        deviations.push_back(std::abs(x - r.median));
+    }
+    r.mean = sum / n;
+    std::sort(deviations.begin(), deviations.end());
+    r.mad = bench_median(deviations);
+
+    // order statistics bracketing the median with ~95% coverage, no normality assumption
+    const auto half_width = 0.98 * std::sqrt(double(n));
+    const auto lo = std::clamp(std::floor(n / 2.0 - half_width), 1.0, double(n));
+    const auto hi = std::clamp(std::ceil(n / 2.0 + 1 + half_width), 1.0, double(n));
+    r.ci_low = s[size_t(lo) - 1];
+    r.ci_high = s[size_t(hi) - 1];
+}
+
+bench_result run_bench(const bench_case& bench, const bench_options& options) {
+    // warmup, doubling the iteration count, which also tells us the rough cost per iteration
+    auto iterations = uint64_t { 1 };
+    auto per_iteration = 0.0;
+    auto warmed = std::chrono::nanoseconds { 0 };
+    while (true) {
+        auto state = bench_state { iterations };
+        bench.func(state);
+        if (!state.completed()) {
+            // the iteration count would double forever
+            auto result = bench_result {};
+            result.name = bench.name;
+            result.error = "the body has to run `for (auto _ : state)` to completion";
+            return result;
+        }
+        const auto t = state.elapsed_time();
+        warmed += t;
+        per_iteration = double(t.count()) / iterations;
+        if (warmed >= options.warmup && t >= options.sample_time / 4) {
+            break;
+        }
+        if (t < options.sample_time) {
+            iterations *= 2;
+        }
+    }
+
+    auto result = bench_result {};
+    result.name = bench.name;
+    result.iterations = std::max(uint64_t { 1 }, uint64_t(double(options.sample_time.count()) / std::max(per_iteration, 1e-3)));
+    auto counters = std::optional<perf_counters> {};
+    if (options.counters) {
+        counters.emplace();
+        if (!counters->is_open()) {
+            static auto warned = false;
+            if (!std::exchange(warned, true)) {
+                log("perf_event_open unavailable, no hardware counters (check /proc/sys/kernel/perf_event_paranoid)");
+            }
+            counters.reset();
+        }
+    }
+    auto totals = perf_values {};
+    auto counted = uint64_t { 0 };
+
+    auto spent = std::chrono::nanoseconds { 0 };
+    for (auto i = size_t { 0 }; i < options.samples; i++) {
+        if (i >= options.min_samples && spent >= options.max_time) {
+            break;
+        }
+        auto state = bench_state { result.iterations, counters ? &*counters : nullptr };
+        bench.func(state);
+        spent += state.elapsed_time();
+        result.samples.push_back(double(state.elapsed_time().count()) / result.iterations);
+        result.items_per_iteration = state.items_per_iteration();
+        if (counters) {
+            const auto values = counters->read();
+            for (auto e = size_t { 0 }; e < totals.size(); e++) {
+                totals[e] = values[e] == perf_unavailable || totals[e] == perf_unavailable ? perf_unavailable : totals[e] + values[e];
+            }
+            counted += result.iterations;
+        }
+    }
+    if (counted) {
+        for (auto e = size_t { 0 }; e < totals.size(); e++) {
+            result.counters[e] = totals[e] == perf_unavailable ? -1.0 : double(totals[e]) / counted;
+        }
+    }
+    bench_summarize(result);
+    return result;
+}
+
+std::string bench_format_time(double ns) {
+    static constexpr const char* units[] = { "ns", "us", "ms", "s" };
+    auto unit = 0;
+    while (std::abs(ns) >= 1000 && unit < 3) {
+        ns /= 1000;
+        unit++;
+    }
+    char buf[32];
+    const auto precision = std::abs(ns) >= 100 ? 1 : std::abs(ns) >= 10 ? 2 : 3;
+    const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), ns, std::chars_format::fixed, precision);
+    return std::string(buf, end) + units[unit];
+}
+
+// "    cycles 123.4  instructions 456.7  IPC 3.70  cache-misses 0.12  branch-misses 0.01  per item"
+static void log_bench_counters(const bench_result& r) {
+    const auto per = r.items_per_iteration ? double(r.items_per_iteration) : 1.0;
+    auto line = std::string { "    " };
+    auto append = [&](std::string_view name, double value) {
+        char buf[32];
+        const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, value < 10 ? 3 : 1);
+        line.append(name).append(" ").append(buf, end).append("  ");
+    };
+    for (auto e = size_t { 0 }; e < r.counters.size(); e++) {
+        if (r.counters[e] >= 0) {
+            append(perf_event_name(perf_event(e)), r.counters[e] / per);
+        }
+        if (perf_event(e) == perf_event::instructions && r.counters[e] >= 0 && r.counters[0] > 0) {
+            append("IPC", r.counters[e] / r.counters[0]);
+        }
+    }
+    line.append(r.items_per_iteration ? "per item" : "per iteration");
+    log<false>(line);
+}
+
+std::vector<bench_result> run_benchmarks(const std::vector<std::string_view>& filters, const bench_options& options) {
+    log(Colors::FG_YELLOW2, "Running benchmarks", Colors::FG_DEFAULT);
+    auto results = std::vector<bench_result> {};
+    auto failed = 0;
+    for (auto& b : ALL_BENCHES()) {
+        const auto selected = filters.empty() || std::any_of(filters.begin(), filters.end(), [&](auto f) {
+            return b.name.find(f) != std::string::npos;
+        });
+        if (!selected) {
+            continue;
+        }
+        auto r = run_bench(b, options);
+        if (!r.error.empty()) {
+            log<false>(Colors::FG_RED, r.name, " error: ", r.error, Colors::FG_DEFAULT);
+            failed++;
+            continue;
+        }
+        results.emplace_back(r);
+        auto per_item = std::string {};
+        if (r.items_per_iteration) {
+            per_item = "  (" + bench_format_time(r.median / r.items_per_iteration) + "/item)";
+        }
+        log<false>(
+            r.name, " ", log_pad { 48 }, bench_format_time(r.median), " ± ", bench_format_time(r.mad),
+            "  ", log_pad { 72 }, "95% [", bench_format_time(r.ci_low), ", ", bench_format_time(r.ci_high), "]  ", log_pad { 104 },
+            r.samples.size(), " x ", r.iterations, per_item
+        );
+        if (r.has_counters()) {
+            log_bench_counters(r);
+        }
+    }
+    log<false>(Colors::FG_YELLOW2, "Benchmarks complete", Colors::FG_DEFAULT, ": ", results.size(), " run", failed ? ", " + std::to_string(failed) + " failed" : "");
+    return results;
+}
+
+#endif
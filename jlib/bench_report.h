@@ -0,0 +1,391 @@
+// bench_report.h
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "bench_framework.h"
+#include "generic_ostream.h"
+
+/*
+machine-readable benchmark results, and comparison between two runs
+
+    bench_jlib --json=before.json
+    (upgrade jlib)
+    bench_jlib --json=after.json
+    bench_jlib --compare before.json after.json
+
+    - write_bench_json / write_bench_csv: one record per benchmark, summary statistics plus
+        every per-iteration sample in ns, and hardware counters when measured
+    - read_bench_json reads back what write_bench_json wrote
+    - compare_benchmarks matches benchmarks by name and runs a Mann-Whitney U test on the
+        samples: a change is flagged only if it is significant (p < alpha) and the medians
+        differ by more than threshold, so noise and tiny real differences both pass
+    - benchmarks in the baseline but not in the current run are reported as missing, and fail
+        the comparison like a regression, so renaming or deleting one can't hide a slowdown;
+        new benchmarks with no baseline are ignored
+*/
+
+void write_bench_json(std::ostream& out, const std::vector<bench_result>& results);
+void write_bench_csv(std::ostream& out, const std::vector<bench_result>& results);
+
+// throws std::runtime_error on malformed input
+std::vector<bench_result> read_bench_json(std::istream& in);
+
+enum class bench_verdict { same, improvement, regression, missing };
+
+struct bench_comparison {
+    std::string name;
+    double baseline_median = 0; // ns per iteration
+    double current_median = 0; // 0 if missing
+    double ratio = 1; // current / baseline, > 1 is slower
+    double p_value = 1;
+    bench_verdict verdict = bench_verdict::same;
+};
+
+struct bench_compare_options {
+    double alpha = 0.01;
+    double threshold = 0.05; // relative change of the median
+};
+
+// Mann-Whitney U test, two-sided p-value via the normal approximation with tie correction
+double bench_mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b);
+
+std::vector<bench_comparison> compare_benchmarks(
+    const std::vector<bench_result>& baseline, const std::vector<bench_result>& current, const bench_compare_options& options = {}
+);
+
+// logs every comparison, returns the number of regressions plus missing benchmarks
+size_t log_bench_comparison(const std::vector<bench_comparison>& comparisons);
+
+#ifdef JLIB_IMPLEMENTATION
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+static void bench_number(std::ostream& out, double x) {
+    char buf[32];
+    const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), x);
+    out.write(buf, end - buf);
+}
+
+// json has no nan or inf (e.g. the statistics of an empty sample), they're written as null
+static void bench_json_number(std::ostream& out, double x) {
+    if (std::isfinite(x)) {
+        bench_number(out, x);
+    } else {
+        out << "null";
+    }
+}
+
+static constexpr const char* bench_counter_fields[] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+
+void write_bench_json(std::ostream& out, const std::vector<bench_result>& results) {
+    out << "{\"benchmarks\":[";
+    auto first = true;
+    for (auto& r : results) {
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, r.name);
+        out << ",\"iterations\":" << r.iterations << ",\"items_per_iteration\":" << r.items_per_iteration;
+        const std::pair<const char*, double> fields[] = {
+            { "median_ns", r.median }, { "mad_ns", r.mad }, { "ci_low_ns", r.ci_low }, { "ci_high_ns", r.ci_high },
+            { "mean_ns", r.mean },     { "min_ns", r.min }, { "max_ns", r.max },
+        };
+        for (auto& [name, value] : fields) {
+            out << ",\"" << name << "\":";
+            bench_json_number(out, value);
+        }
+        for (auto e = size_t { 0 }; e < r.counters.size(); e++) {
+            if (r.counters[e] >= 0) {
+                out << ",\"" << bench_counter_fields[e] << "\":";
+                bench_json_number(out, r.counters[e]);
+            }
+        }
+        out << ",\"samples_ns\":[";
+        for (auto i = size_t { 0 }; i < r.samples.size(); i++) {
+            if (i) {
+                out << ',';
+            }
+            bench_json_number(out, r.samples[i]);
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
+void write_bench_csv(std::ostream& out, const std::vector<bench_result>& results) {
+    out << "name,iterations,items_per_iteration,median_ns,mad_ns,ci_low_ns,ci_high_ns,mean_ns,min_ns,max_ns";
+    for (auto* f : bench_counter_fields) {
+        out << ',' << f;
+    }
+    out << ",samples_ns\n";
+    for (auto& r : results) {
+        out << '"';
+        for (auto c : r.name) {
+            out << c;
+            if (c == '"') {
+                out << '"';
+            }
+        }
+        out << "\"," << r.iterations << ',' << r.items_per_iteration;
+        for (auto x : { r.median, r.mad, r.ci_low, r.ci_high, r.mean, r.min, r.max }) {
+            out << ',';
+            bench_number(out, x);
+        }
+        for (auto x : r.counters) {
+            out << ',';
+            if (x >= 0) {
+                bench_number(out, x);
+            }
+        }
+        // space separated, so the column stays a single field
+        out << ',';
+        for (auto i = size_t { 0 }; i < r.samples.size(); i++) {
+            if (i) {
+                out << ' ';
+            }
+            bench_number(out, r.samples[i]);
+        }
+        out << '\n';
+    }
+}
+
+// just enough json for what write_bench_json produces: objects, arrays, strings, numbers, null as nan
+struct bench_json_reader {
+    std::string text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const char* what) {
+        throw std::runtime_error("bench json: " + std::string { what } + " at offset " + std::to_string(pos));
+    }
+    void skip_space() {
+        while (pos < text.size() && std::isspace(uint8_t(text[pos]))) {
+            pos++;
+        }
+    }
+    bool consume(char c) {
+        skip_space();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+    void expect(char c) {
+        if (!consume(c)) {
+            fail("unexpected character");
+        }
+    }
+    std::string string() {
+        expect('"');
+        auto s = std::string {};
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\' && pos + 1 < text.size()) {
+                pos++;
+            }
+            s += text[pos++];
+        }
+        expect('"');
+        return s;
+    }
+    double number() {
+        skip_space();
+        if (text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        auto x = 0.0;
+        const auto [end, ec] = std::from_chars(text.data() + pos, text.data() + text.size(), x);
+        if (ec != std::errc {}) {
+            fail("expected a number");
+        }
+        pos = end - text.data();
+        return x;
+    }
+    std::vector<double> numbers() {
+        expect('[');
+        auto v = std::vector<double> {};
+        if (consume(']')) {
+            return v;
+        }
+        do {
+            v.push_back(number());
+        } while (consume(','));
+        expect(']');
+        return v;
+    }
+};
+
+std::vector<bench_result> read_bench_json(std::istream& in) {
+    auto json = bench_json_reader { std::string { std::istreambuf_iterator<char> { in }, {} } };
+    auto results = std::vector<bench_result> {};
+    json.expect('{');
+    if (json.string() != "benchmarks") {
+        json.fail("expected \"benchmarks\"");
+    }
+    json.expect(':');
+    json.expect('[');
+    if (json.consume(']')) {
+        return results;
+    }
+    do {
+        auto& r = results.emplace_back();
+        json.expect('{');
+        do {
+            const auto key = json.string();
+            json.expect(':');
+            if (key == "name") {
+                r.name = json.string();
+            } else if (key == "samples_ns") {
+                r.samples = json.numbers();
+            } else {
+                const auto x = json.number();
+                static const auto fields = std::unordered_map<std::string_view, double bench_result::*> {
+                    { "median_ns", &bench_result::median }, { "mad_ns", &bench_result::mad }, { "ci_low_ns", &bench_result::ci_low },
+                    { "ci_high_ns", &bench_result::ci_high }, { "mean_ns", &bench_result::mean }, { "min_ns", &bench_result::min },
+                    { "max_ns", &bench_result::max },
+                };
+                if (key == "iterations") {
+                    r.iterations = uint64_t(x);
+                } else if (key == "items_per_iteration") {
+                    r.items_per_iteration = uint64_t(x);
+                } else if (auto f = fields.find(key); f != fields.end()) {
+                    r.*(f->second) = x;
+                } else {
+                    for (auto e = size_t { 0 }; e < r.counters.size(); e++) {
+                        if (key == bench_counter_fields[e]) {
+                            r.counters[e] = x;
+                        }
+                    }
+                }
+            }
+        } while (json.consume(','));
+        json.expect('}');
+    } while (json.consume(','));
+    json.expect(']');
+    json.expect('}');
+    return results;
+}
+
+double bench_mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    const auto n1 = double(a.size());
+    const auto n2 = double(b.size());
+    if (a.empty() || b.empty()) {
+        return 1.0;
+    }
+    // rank the pooled samples, ties get the average rank
+    auto pooled = std::vector<std::pair<double, bool>> {};
+    for (auto x : a) {
+        pooled.emplace_back(x, true);
+    }
+    for (auto x : b) {
+        pooled.emplace_back(x, false);
+    }
+    std::sort(pooled.begin(), pooled.end());
+    auto rank_sum_a = 0.0;
+    auto tie_term = 0.0;
+    for (auto i = size_t { 0 }; i < pooled.size();) {
+        auto j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+            j++;
+        }
+        const auto rank = (double(i + 1) + double(j)) / 2;
+        for (auto k = i; k < j; k++) {
+            if (pooled[k].second) {
+                rank_sum_a += rank;
+            }
+        }
+        const auto t = double(j - i);
+        tie_term += t * t * t - t;
+        i = j;
+    }
+    const auto u = rank_sum_a - n1 * (n1 + 1) / 2;
+    const auto n = n1 + n2;
+    const auto mean = n1 * n2 / 2;
+    const auto variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)));
+    if (variance <= 0) {
+        return 1.0; // every sample identical
+    }
+    // continuity correction
+    const auto z = std::max(0.0, std::abs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<bench_comparison> compare_benchmarks(
+    const std::vector<bench_result>& baseline, const std::vector<bench_result>& current, const bench_compare_options& options
+) {
+    auto by_name = std::unordered_map<std::string_view, const bench_result*> {};
+    for (auto& b : baseline) {
+        by_name[b.name] = &b;
+    }
+    auto comparisons = std::vector<bench_comparison> {};
+    for (auto& c : current) {
+        const auto found = by_name.find(c.name);
+        if (found == by_name.end()) {
+            continue;
+        }
+        const auto& b = *found->second;
+        by_name.erase(found);
+        auto& r = comparisons.emplace_back();
+        r.name = c.name;
+        r.baseline_median = b.median;
+        r.current_median = c.median;
+        r.ratio = b.median > 0 ? c.median / b.median : 1.0;
+        r.p_value = bench_mann_whitney_p(b.samples, c.samples);
+        if (r.p_value < options.alpha && std::abs(r.ratio - 1) > options.threshold) {
+            r.verdict = r.ratio > 1 ? bench_verdict::regression : bench_verdict::improvement;
+        }
+    }
+    for (auto& b : baseline) {
+        if (by_name.contains(b.name)) {
+            auto& r = comparisons.emplace_back();
+            r.name = b.name;
+            r.baseline_median = b.median;
+            r.verdict = bench_verdict::missing;
+            by_name.erase(b.name); // once, even if the baseline repeats a name
+        }
+    }
+    return comparisons;
+}
+
+size_t log_bench_comparison(const std::vector<bench_comparison>& comparisons) {
+    auto regressions = size_t { 0 };
+    auto missing = size_t { 0 };
+    for (auto& c : comparisons) {
+        if (c.verdict == bench_verdict::missing) {
+            log<false>(
+                c.name, " ", log_pad { 48 }, bench_format_time(c.baseline_median), " -> ?  ", log_pad { 88 }, Colors::FG_RED,
+                "MISSING from current run", Colors::FG_DEFAULT
+            );
+            missing++;
+            continue;
+        }
+        const auto color = c.verdict == bench_verdict::regression    ? Colors::FG_RED
+                         : c.verdict == bench_verdict::improvement ? Colors::FG_GREEN
+                                                                   : Colors::FG_DEFAULT;
+        const auto* label = c.verdict == bench_verdict::regression    ? "REGRESSION"
+                          : c.verdict == bench_verdict::improvement ? "improvement"
+                                                                    : "same";
+        char change[16];
+        const auto [end, ec] = std::to_chars(change, change + sizeof(change), (c.ratio - 1) * 100, std::chars_format::fixed, 1);
+        log<false>(
+            c.name, " ", log_pad { 48 }, bench_format_time(c.baseline_median), " -> ", bench_format_time(c.current_median), "  ",
+            log_pad { 76 }, c.ratio >= 1 ? "+" : "", std::string_view { change, size_t(end - change) }, "%  ", log_pad { 88 }, "p=",
+            c.p_value, "  ", color, label, Colors::FG_DEFAULT
+        );
+        regressions += c.verdict == bench_verdict::regression;
+    }
+    log<false>(
+        Colors::FG_YELLOW2, "Comparison complete", Colors::FG_DEFAULT, ": ", comparisons.size() - missing, " compared, ", regressions,
+        " regressions, ", missing, " missing"
+    );
+    return regressions + missing;
+}
+
+#endif
@@ -1,47 +1,215 @@
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
+#include <mutex>
+#include <span>
+#include <system_error>
 #include <vector>
-#include <cstdint>
+
+#include "mapped_file.h"
 
 // read binary file
 // blockingly read the entire file in one go
 // returns false if file couldn't be opened or read; true otherwise
 // out_data is overwritten and resized once to fit the entire file
+// to avoid the copy (and the second copy of the file in memory), use mapped_file and bytes() instead
 bool read_binary_file(const std::filesystem::path& path, std::vector<uint8_t>& out_data);
 
 // write binary file
 // blockingly write the whole file in one go
-// returns true if all data was successfully written; false otherwise
-bool write_binary_file(const std::filesystem::path& path, const std::vector<uint8_t>& data);
+// returns true if all data was successfully written and the file closed; false otherwise
+bool write_binary_file(const std::filesystem::path& path, std::span<const uint8_t> data);
+
+// binary file reader
+// positional reads into caller provided buffers, with pread where available
+// reads don't share a file position, so one reader can serve several threads at once
+// errors are reported through the std::error_code out parameter, cleared on success
+class binary_file_reader {
+public:
+    binary_file_reader() = default;
+    binary_file_reader(const std::filesystem::path& path, std::error_code& ec) {
+        open(path, ec);
+    }
+    binary_file_reader(const binary_file_reader&) = delete;
+    binary_file_reader& operator=(const binary_file_reader&) = delete;
+    ~binary_file_reader() {
+        close();
+    }
+
+    bool open(const std::filesystem::path& path, std::error_code& ec);
+    void close();
+
+    bool is_open() const;
+    // size when opened
+    uint64_t size() const {
+        return file_size;
+    }
+
+    // read up to out.size() bytes at offset, retrying interrupted and partial reads
+    // returns the number of bytes read, which is less than out.size() only at the end of the file or on error
+    size_t read_at(uint64_t offset, std::span<uint8_t> out, std::error_code& ec) const;
+
+    // read exactly out.size() bytes at offset
+    // returns false on error, or if the file ends first (ec is then std::errc::result_out_of_range)
+    bool read_exact_at(uint64_t offset, std::span<uint8_t> out, std::error_code& ec) const {
+        if (read_at(offset, out, ec) == out.size()) {
+            return true;
+        }
+        if (!ec) {
+            ec = std::make_error_code(std::errc::result_out_of_range);
+        }
+        return false;
+    }
+
+private:
+    uint64_t file_size = 0;
+#if (defined __unix__ || defined __APPLE__)
+    int fd = -1;
+#else
+    std::FILE* file = nullptr;
+    mutable std::mutex lock; // no pread, seek and read have to go together
+#endif
+};
 
 #ifdef JLIB_IMPLEMENTATION
 
+#include <cerrno>
 #include <fstream>
 
+#if (defined __unix__ || defined __APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 bool read_binary_file(const std::filesystem::path& path, std::vector<uint8_t>& out_data) {
-    if (!std::filesystem::exists(path)) {
+    auto ec = std::error_code {};
+    auto reader = binary_file_reader(path, ec);
+    if (ec) {
         return false;
     }
-    auto length = std::filesystem::file_size(path);
-    auto file = std::ifstream(path);
+    out_data.resize(reader.size());
+    return reader.read_exact_at(0, out_data, ec);
+}
+
+bool write_binary_file(const std::filesystem::path& path, std::span<const uint8_t> data) {
+    auto file = std::ofstream(path, std::ios::binary);
     if (!file.is_open()) {
         return false;
     }
+    file.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+    file.close();
+    return !file.fail();
+}
+
+#if (defined __unix__ || defined __APPLE__)
 
-    out_data.resize(length);
-    file.read((char*)out_data.data(), length);
+bool binary_file_reader::open(const std::filesystem::path& path, std::error_code& ec) {
+    close();
+    ec.clear();
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ec = std::error_code(errno, std::generic_category());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ec = std::error_code(errno, std::generic_category());
+        close();
+        return false;
+    }
+    file_size = uint64_t(st.st_size);
     return true;
 }
 
-bool write_binary_file(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
-    auto file = std::ofstream(path, std::ios::binary);
-    if (!file.is_open()) {
+void binary_file_reader::close() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    file_size = 0;
+}
+
+bool binary_file_reader::is_open() const {
+    return fd >= 0;
+}
+
+size_t binary_file_reader::read_at(uint64_t offset, std::span<uint8_t> out, std::error_code& ec) const {
+    ec.clear();
+    if (fd < 0) {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        return 0;
+    }
+    auto done = size_t { 0 };
+    while (done < out.size()) {
+        const auto n = pread(fd, out.data() + done, out.size() - done, off_t(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ec = std::error_code(errno, std::generic_category());
+            break;
+        }
+        if (n == 0) {
+            break; // end of file
+        }
+        done += size_t(n);
+    }
+    return done;
+}
+
+#else
+
+bool binary_file_reader::open(const std::filesystem::path& path, std::error_code& ec) {
+    close();
+    ec.clear();
+    file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        file_size = 0;
+        return false;
+    }
+    file = std::fopen(path.string().c_str(), "rb");
+    if (!file) {
+        ec = std::error_code(errno, std::generic_category());
+        file_size = 0;
         return false;
     }
-    file.write(reinterpret_cast<const char*>(data.data()), data.size());
-    // TODO: check badbit/n written
     return true;
 }
 
+void binary_file_reader::close() {
+    if (file) {
+        std::fclose(file);
+    }
+    file = nullptr;
+    file_size = 0;
+}
+
+bool binary_file_reader::is_open() const {
+    return file != nullptr;
+}
+
+size_t binary_file_reader::read_at(uint64_t offset, std::span<uint8_t> out, std::error_code& ec) const {
+    ec.clear();
+    if (!file) {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        return 0;
+    }
+    auto guard = std::lock_guard { lock };
+    if (_fseeki64(file, int64_t(offset), SEEK_SET) != 0) {
+        ec = std::error_code(errno, std::generic_category());
+        return 0;
+    }
+    const auto n = std::fread(out.data(), 1, out.size(), file);
+    if (n < out.size() && std::ferror(file)) {
+        ec = std::make_error_code(std::errc::io_error);
+        std::clearerr(file);
+    }
+    return n;
+}
+
+#endif
+
 #endif
@@ -0,0 +1,169 @@
+// concurrent_heap.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "heapsort.h"
+
+/*
+concurrent_priority_queue<T, Compare>
+
+relaxed "multi-queue" priority queue for many producers/consumers
+    - N shards, each a mutex + dynamic_heap
+    - push: lock a random shard (try_lock, move on if it's busy)
+    - try_pop: look at two random shards and pop from the one with the better top
+
+pop order is approximate: the popped element is near the top, not necessarily the top
+in exchange there's no single lock everyone fights over
+try_pop only reports empty after sweeping every shard, so it doesn't give up spuriously
+*/
+
+template<typename T, typename Compare = std::greater<T>> class concurrent_priority_queue {
+public:
+    explicit concurrent_priority_queue(size_t num_shards = 2 * std::max(std::thread::hardware_concurrency(), 1u)):
+        num_shards(std::max(num_shards, size_t { 2 })),
+        shards(std::make_unique<shard[]>(this->num_shards)) {}
+    concurrent_priority_queue(const concurrent_priority_queue&) = delete;
+    concurrent_priority_queue& operator=(const concurrent_priority_queue&) = delete;
+
+    void push(const T& t) {
+        emplace(t);
+    }
+    void push(T&& t) {
+        emplace(std::move(t));
+    }
+    template<typename... Args> void emplace(Args&&... args) {
+        // try a few random shards without blocking, then just wait on one
+        for (auto attempt = 0u; attempt < num_shards; attempt++) {
+            auto& s = shards[pick()];
+            if (auto lock = std::unique_lock { s.lock, std::try_to_lock }) {
+                s.push(std::forward<Args>(args)...);
+                return;
+            }
+        }
+        auto& s = shards[pick()];
+        auto lock = std::unique_lock { s.lock };
+        s.push(std::forward<Args>(args)...);
+    }
+
+    // pop an element near the top; returns false if the queue is empty
+    bool try_pop(T& out) {
+        for (auto attempt = 0u; attempt < num_shards; attempt++) {
+            if (try_pop_two(pick(), pick(), out, 1) == 1) {
+                return true;
+            }
+        }
+        return sweep(out, 1) == 1;
+    }
+
+    // pop up to max elements from the better of two shards
+    // amortizes locking when the caller can consume a batch (eg. a scheduler filling a local queue)
+    // appends to out and returns the number of elements popped
+    size_t try_pop_batch(std::vector<T>& out, size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+        for (auto attempt = 0u; attempt < num_shards; attempt++) {
+            if (auto n = try_pop_two(pick(), pick(), out, max)) {
+                return n;
+            }
+        }
+        return sweep(out, max);
+    }
+
+    // approximate while other threads are pushing/popping
+    size_t size() const {
+        auto total = size_t { 0 };
+        for (auto i = 0u; i < num_shards; i++) {
+            total += shards[i].count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+
+private:
+    struct alignas(64) shard {
+        std::mutex lock;
+        dynamic_heap<T, Compare> heap;
+        std::atomic<size_t> count = 0; // readable without the lock
+
+        template<typename... Args> void push(Args&&... args) {
+            heap.emplace(std::forward<Args>(args)...);
+            count.store(heap.get_count(), std::memory_order_relaxed);
+        }
+        size_t pop_into(T& out, size_t) {
+            out = heap.pop();
+            count.store(heap.get_count(), std::memory_order_relaxed);
+            return 1;
+        }
+        size_t pop_into(std::vector<T>& out, size_t max) {
+            auto n = size_t { 0 };
+            while (n < max && !heap.empty()) {
+                out.emplace_back(heap.pop());
+                n++;
+            }
+            count.store(heap.get_count(), std::memory_order_relaxed);
+            return n;
+        }
+    };
+
+    size_t num_shards;
+    std::unique_ptr<shard[]> shards;
+    Compare compare;
+
+    size_t pick() {
+        // xorshift, one state per thread
+        thread_local auto state = uint64_t(std::hash<std::thread::id> {}(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state % num_shards;
+    }
+
+    template<typename Out> size_t try_pop_two(size_t a, size_t b, Out& out, size_t max) {
+        auto& sa = shards[a];
+        auto& sb = shards[b];
+        const auto a_empty = sa.count.load(std::memory_order_relaxed) == 0;
+        const auto b_empty = a == b || sb.count.load(std::memory_order_relaxed) == 0;
+        if (a_empty && b_empty) {
+            return 0;
+        }
+        if (a_empty || b_empty) {
+            auto& s = a_empty ? sb : sa;
+            auto lock = std::unique_lock { s.lock, std::try_to_lock };
+            return (lock && !s.heap.empty()) ? s.pop_into(out, max) : 0;
+        }
+
+        // lock in index order so two poppers can't hold one each and spin on the other
+        auto& first = a < b ? sa : sb;
+        auto& second = a < b ? sb : sa;
+        auto lock1 = std::unique_lock { first.lock, std::try_to_lock };
+        auto lock2 = std::unique_lock { second.lock, std::try_to_lock };
+        auto* best = (shard*)nullptr;
+        for (auto* s : { lock1 ? &first : nullptr, lock2 ? &second : nullptr }) {
+            if (s && !s->heap.empty() && (!best || compare(s->heap.top(), best->heap.top()))) {
+                best = s;
+            }
+        }
+        return best ? best->pop_into(out, max) : 0;
+    }
+
+    template<typename Out> size_t sweep(Out& out, size_t max) {
+        for (auto i = 0u; i < num_shards; i++) {
+            auto& s = shards[i];
+            auto lock = std::unique_lock { s.lock };
+            if (!s.heap.empty()) {
+                return s.pop_into(out, max);
+            }
+        }
+        return 0;
+    }
+};
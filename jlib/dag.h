@@ -2,28 +2,332 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <tuple>
 #include <vector>
 
-template <typename Type, typename Storage> class directed_acyclic_graph {
-    // Storage vertices;
-    std::vector<Type> vertices;
+#include "heapsort.h"
+#include "task_engine.h"
+
+/*
+directed_acyclic_graph<Type>
+
+vertices hold user data, edge(a, b) means a has to run before b
+    - adjacency is kept as CSR (offsets + targets), rebuilt lazily after edits
+    - topological_sort: Kahn's algorithm, reports cycles
+    - execute: run f(index, vertex) in dependency order, serially or across a task_engine;
+        in parallel mode a vertex is submitted as soon as its last dependency finishes
+    - reevaluate: incremental version of execute
+        vertices are dirty when added, when they gain an incoming edge, or via mark_dirty()
+        only dirty vertices and whatever is downstream of them are visited
+        f returns bool "my result changed"; if it returns false, dependents aren't dirtied by it
+        results are cached in the vertex data itself
+*/
+
+template <typename Type, typename Storage = std::vector<Type>> class directed_acyclic_graph {
+    Storage vertices;
     std::vector<std::pair<size_t, size_t>> edges;
 
+    // CSR adjacency built from edges
+    bool built = false;
+    std::vector<size_t> offsets; // successors of v are targets[offsets[v] .. offsets[v + 1]]
+    std::vector<size_t> targets;
+    std::vector<size_t> in_degree;
+
+    // incremental evaluation
+    bool ordered = false;
+    std::vector<size_t> topo_position;
+    std::vector<uint8_t> dirty;
+    std::vector<size_t> dirty_list;
+
 public:
+    directed_acyclic_graph() = default;
     directed_acyclic_graph(const directed_acyclic_graph&) = default;
     directed_acyclic_graph(directed_acyclic_graph&&) = default;
     directed_acyclic_graph& operator=(const directed_acyclic_graph&) = default;
     directed_acyclic_graph& operator=(directed_acyclic_graph&&) = default;
 
+    // add an edge; from must be executed before to
     void edge(size_t from, size_t to) {
         edges.emplace_back(from, to);
-        while (false) {}
+        built = false;
+        mark_dirty(to);
     }
 
-    template <typename... Args> void vertex(Args&&... args) {
-        vertices.emplace_back(std::forward(args...));
+    // add a vertex, returns its index
+    template <typename... Args> size_t vertex(Args&&... args) {
+        vertices.emplace_back(std::forward<Args>(args)...);
+        built = false;
+        dirty.emplace_back(0);
+        mark_dirty(vertices.size() - 1);
+        return vertices.size() - 1;
+    }
+
+    // v (and everything downstream of it, unless cut off) will be re-run by the next reevaluate()
+    void mark_dirty(size_t v) {
+        if (v < dirty.size() && !dirty[v]) {
+            dirty[v] = 1;
+            dirty_list.emplace_back(v);
+        }
+    }
+    bool is_dirty(size_t v) const {
+        return dirty[v];
+    }
+    bool any_dirty() const {
+        return dirty_list.size();
+    }
+
+    size_t size() const {
+        return vertices.size();
+    }
+    Type& operator[](size_t index) {
+        return vertices[index];
+    }
+    const Type& operator[](size_t index) const {
+        return vertices[index];
+    }
+
+    // vertices that depend directly on v
+    std::span<const size_t> successors(size_t v) {
+        build();
+        return { targets.data() + offsets[v], targets.data() + offsets[v + 1] };
+    }
+
+    // (re)build the CSR adjacency from the edge list
+    // throws if an edge refers to a vertex that doesn't exist
+    void build() {
+        if (built) {
+            return;
+        }
+        const auto n = vertices.size();
+        offsets.assign(n + 1, 0);
+        in_degree.assign(n, 0);
+        for (auto& [from, to] : edges) {
+            if (from >= n || to >= n) {
+                throw std::runtime_error("dag edge refers to a missing vertex");
+            }
+            offsets[from + 1]++;
+            in_degree[to]++;
+        }
+        for (auto v = 0u; v < n; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        targets.resize(edges.size());
+        ordered = false;
+        auto cursor = std::vector<size_t>(offsets.begin(), offsets.end() - 1);
+        for (auto& [from, to] : edges) {
+            targets[cursor[from]++] = to;
+        }
+        built = true;
+    }
+
+    // Kahn topological sort
+    // returns false if the graph has a cycle (order then only holds the vertices outside it)
+    bool topological_sort(std::vector<size_t>& order) {
+        build();
+        const auto n = vertices.size();
+        order.clear();
+        order.reserve(n);
+
+        auto remaining = in_degree;
+        for (auto v = 0u; v < n; v++) {
+            if (remaining[v] == 0) {
+                order.emplace_back(v);
+            }
+        }
+        // order doubles as the queue
+        for (auto i = 0u; i < order.size(); i++) {
+            for (auto s : successors(order[i])) {
+                if (--remaining[s] == 0) {
+                    order.emplace_back(s);
+                }
+            }
+        }
+        return order.size() == n;
     }
-};
 
-// TODO: topo sort
\ No newline at end of file
+    // run f(index, vertex) for every vertex in dependency order on the calling thread
+    // throws if the graph has a cycle
+    template <typename F> void execute(F&& f) {
+        auto order = std::vector<size_t> {};
+        if (!topological_sort(order)) {
+            throw std::runtime_error("dag has a cycle");
+        }
+        for (auto v : order) {
+            f(v, vertices[v]);
+        }
+    }
+
+    // run f(index, vertex) for every vertex across the engine
+    // a vertex starts as soon as all of its dependencies have finished
+    // throws (before running anything) if the graph has a cycle
+    template <typename F> void execute(task_engine& engine, F&& f) {
+        auto order = std::vector<size_t> {};
+        if (!topological_sort(order)) {
+            throw std::runtime_error("dag has a cycle");
+        }
+
+        auto state = parallel_state<F> { *this, engine, f };
+        for (auto v = 0u; v < vertices.size(); v++) {
+            state.remaining[v].store(in_degree[v], std::memory_order_relaxed);
+        }
+        for (auto v = 0u; v < vertices.size(); v++) {
+            if (in_degree[v] == 0) {
+                state.submit(v);
+            }
+        }
+        engine.wait(state.group);
+    }
+
+    // re-run f(index, vertex) -> bool (changed) for the dirty part of the graph, in dependency order
+    // a vertex runs if it was marked dirty or a dependency reported a change
+    // returns the number of vertices f was called for
+    // throws if the graph has a cycle
+    template <typename F> size_t reevaluate(F&& f) {
+        update_order();
+
+        // visit pending vertices by topological position
+        // successors always sit later in the order, so each vertex is visited at most once
+        auto pending = dynamic_heap<size_t, std::less<size_t>> {};
+        for (auto v : dirty_list) {
+            pending.push(topo_position[v]);
+        }
+        dirty_list.clear();
+
+        auto evaluated = size_t { 0 };
+        while (!pending.empty()) {
+            const auto v = topo_order[pending.pop()];
+            dirty[v] = 0;
+            evaluated++;
+            if (f(v, vertices[v])) {
+                for (auto s : successors(v)) {
+                    if (!dirty[s]) {
+                        dirty[s] = 1;
+                        pending.push(topo_position[s]);
+                    }
+                }
+            }
+        }
+        return evaluated;
+    }
+
+    // parallel reevaluate
+    // the downstream closure of the dirty vertices is scheduled like execute(engine, f);
+    // vertices in it whose dependencies all reported no change are skipped without calling f
+    template <typename F> size_t reevaluate(task_engine& engine, F&& f) {
+        update_order();
+
+        // affected = everything reachable from a dirty vertex
+        auto affected = std::vector<uint8_t>(vertices.size(), 0);
+        auto stack = std::vector<size_t> {};
+        for (auto v : dirty_list) {
+            affected[v] = 1;
+            stack.emplace_back(v);
+        }
+        auto state = reevaluate_state<F> { *this, engine, f };
+        while (stack.size()) {
+            const auto v = stack.back();
+            stack.pop_back();
+            for (auto s : successors(v)) {
+                state.remaining[s].fetch_add(1, std::memory_order_relaxed);
+                if (!affected[s]) {
+                    affected[s] = 1;
+                    stack.emplace_back(s);
+                }
+            }
+        }
+        // collect the roots before submitting any, running tasks decrement remaining concurrently
+        std::erase_if(dirty_list, [&](size_t v) { return state.remaining[v].load(std::memory_order_relaxed) != 0; });
+        for (auto v : dirty_list) {
+            state.submit(v);
+        }
+        dirty_list.clear();
+        engine.wait(state.group);
+        return state.evaluated.load();
+    }
+
+private:
+    std::vector<size_t> topo_order;
+
+    void update_order() {
+        build();
+        if (ordered) {
+            return;
+        }
+        if (!topological_sort(topo_order)) {
+            throw std::runtime_error("dag has a cycle");
+        }
+        topo_position.resize(vertices.size());
+        for (auto i = 0u; i < topo_order.size(); i++) {
+            topo_position[topo_order[i]] = i;
+        }
+        ordered = true;
+    }
+
+    template <typename F> struct reevaluate_state {
+        directed_acyclic_graph& graph;
+        task_engine& engine;
+        F& f;
+        std::unique_ptr<std::atomic<size_t>[]> remaining; // affected dependencies still to finish
+        std::unique_ptr<std::atomic<uint8_t>[]> changed_input;
+        std::atomic<size_t> evaluated = 0;
+        wait_group group;
+
+        reevaluate_state(directed_acyclic_graph& graph, task_engine& engine, F& f):
+            graph(graph),
+            engine(engine),
+            f(f),
+            remaining(std::make_unique<std::atomic<size_t>[]>(graph.size())),
+            changed_input(std::make_unique<std::atomic<uint8_t>[]>(graph.size())) {}
+
+        void submit(size_t v) {
+            engine.submit(group, [this, v] {
+                // dirty[v] is only touched by this task while the run is in flight
+                auto changed = false;
+                if (graph.dirty[v] || changed_input[v].load(std::memory_order_relaxed)) {
+                    graph.dirty[v] = 0;
+                    evaluated.fetch_add(1, std::memory_order_relaxed);
+                    changed = f(v, graph.vertices[v]);
+                }
+                for (auto s : graph.successors(v)) {
+                    if (changed) {
+                        changed_input[s].store(1, std::memory_order_relaxed);
+                    }
+                    // acq_rel: the last decrement sees every changed_input store
+                    if (remaining[s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        submit(s);
+                    }
+                }
+            });
+        }
+    };
+
+    template <typename F> struct parallel_state {
+        directed_acyclic_graph& graph;
+        task_engine& engine;
+        F& f;
+        std::unique_ptr<std::atomic<size_t>[]> remaining;
+        wait_group group;
+
+        parallel_state(directed_acyclic_graph& graph, task_engine& engine, F& f):
+            graph(graph),
+            engine(engine),
+            f(f),
+            remaining(std::make_unique<std::atomic<size_t>[]>(graph.size())) {}
+
+        void submit(size_t v) {
+            engine.submit(group, [this, v] {
+                f(v, graph.vertices[v]);
+                for (auto s : graph.successors(v)) {
+                    if (remaining[s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        submit(s);
+                    }
+                }
+            });
+        }
+    };
+};
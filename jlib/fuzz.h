@@ -0,0 +1,243 @@
+// fuzz.h
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+differential fuzzing for containers
+
+drive a jlib container and a reference (usually the STL equivalent) with the same operation
+stream, and fail as soon as they disagree; failing streams are shrunk to a minimal repro
+
+a model holds both containers and knows how to apply one operation to each:
+
+    struct map_model {
+        static constexpr uint8_t op_count = 3;
+        hash_map<uint32_t, uint32_t> subject;
+        std::unordered_map<uint32_t, uint32_t> reference;
+
+        // apply op to both, FUZZ_CHECK anything observable
+        void apply(const fuzz_op& op) {
+            const auto key = op.a % 64;
+            switch (op.code) {
+            case 0: subject.insert_or_assign(key, op.b); reference.insert_or_assign(key, op.b); break;
+            case 1: subject.erase(key); reference.erase(key); break;
+            case 2: FUZZ_CHECK(subject.contains(key) == reference.contains(key)); break;
+            }
+        }
+        // full comparison, run every few ops and at the end
+        void check() const { FUZZ_CHECK(subject.size() == reference.size()); }
+        // optional, for readable repros
+        static std::string describe(const fuzz_op& op);
+    };
+
+    if (auto failure = fuzz_differential<map_model>()) {
+        log(failure->report());
+    }
+
+    - ops are { code, a, b }, the model decides what a and b mean (keys, values, indices...)
+        keep keys in a small range so the stream revisits them
+    - fuzz_differential runs options.runs random streams, and on the first failure shrinks it:
+        drop chunks of ops (delta debugging), then lower the arguments, keeping anything that still fails
+    - exceptions escaping apply() or check() count as failures, crashes are left to the test runner
+        (test_jlib --isolate) or the sanitizers
+    - JLIB_FUZZ_TARGET(model) defines LLVMFuzzerTestOneInput for coverage-guided fuzzing with libFuzzer,
+        each 9 bytes of input decode to one op, see fuzz/ and the JLIB_FUZZ cmake option
+*/
+
+struct fuzz_op {
+    uint8_t code;
+    uint32_t a;
+    uint32_t b;
+};
+
+struct fuzz_mismatch : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+#define FUZZ_CHECK(...)                                                                            \
+    if (!(__VA_ARGS__)) {                                                                          \
+        throw fuzz_mismatch("mismatch: " #__VA_ARGS__);                                            \
+    }
+
+struct fuzz_options {
+    uint64_t seed = 1;
+    size_t runs = 200;
+    size_t ops_per_run = 200;
+    size_t check_every = 16; // full check() interval, in ops
+    size_t shrink_attempts = 10'000;
+};
+
+struct fuzz_failure {
+    std::string message;
+    std::vector<fuzz_op> ops; // shrunk
+    size_t original_size = 0;
+    uint64_t seed = 0;
+    std::vector<std::string> described;
+
+    std::string report() const {
+        auto s = message + " after " + std::to_string(ops.size()) + " ops (shrunk from " + std::to_string(original_size) + ", seed "
+               + std::to_string(seed) + ")";
+        for (auto& d : described) {
+            s += "\n    " + d;
+        }
+        return s;
+    }
+};
+
+// 9 bytes per op: code, a, b little endian; a trailing partial op is ignored
+inline std::vector<fuzz_op> fuzz_decode(const uint8_t* data, size_t size, uint8_t op_count) {
+    auto ops = std::vector<fuzz_op> {};
+    for (auto i = size_t { 0 }; i + 9 <= size; i += 9) {
+        auto op = fuzz_op { uint8_t(data[i] % op_count), 0, 0 };
+        for (auto k = 0; k < 4; k++) {
+            op.a |= uint32_t(data[i + 1 + k]) << (8 * k);
+            op.b |= uint32_t(data[i + 5 + k]) << (8 * k);
+        }
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+inline std::vector<uint8_t> fuzz_encode(const std::vector<fuzz_op>& ops) {
+    auto data = std::vector<uint8_t> {};
+    for (auto& op : ops) {
+        data.push_back(op.code);
+        for (auto k = 0; k < 4; k++) {
+            data.push_back(uint8_t(op.a >> (8 * k)));
+        }
+        for (auto k = 0; k < 4; k++) {
+            data.push_back(uint8_t(op.b >> (8 * k)));
+        }
+    }
+    return data;
+}
+
+template<typename Model> std::string fuzz_describe(const fuzz_op& op) {
+    if constexpr (requires { Model::describe(op); }) {
+        return Model::describe(op);
+    } else {
+        return "op " + std::to_string(op.code) + "(" + std::to_string(op.a) + ", " + std::to_string(op.b) + ")";
+    }
+}
+
+// run ops against a fresh model, returns the failure message if they disagree
+template<typename Model> std::optional<std::string> fuzz_run(const std::vector<fuzz_op>& ops, size_t check_every = 16) {
+    try {
+        auto model = Model {};
+        for (auto i = size_t { 0 }; i < ops.size(); i++) {
+            model.apply(ops[i]);
+            if (check_every && (i + 1) % check_every == 0) {
+                model.check();
+            }
+        }
+        model.check();
+    } catch (const std::exception& e) {
+        return std::string { e.what() };
+    }
+    return std::nullopt;
+}
+
+// smallest subsequence (and smallest arguments) that still fails
+template<typename Model> std::vector<fuzz_op> fuzz_shrink(std::vector<fuzz_op> ops, const fuzz_options& options = {}) {
+    auto attempts = options.shrink_attempts;
+    // check after every op, a shorter stream may never reach the next periodic check
+    auto fails = [&](const std::vector<fuzz_op>& candidate) {
+        if (attempts == 0) {
+            return false;
+        }
+        --attempts;
+        return fuzz_run<Model>(candidate, 1).has_value();
+    };
+
+    // delta debugging: remove chunks, halving the chunk size when nothing can go
+    for (auto chunk = std::max<size_t>(ops.size() / 2, 1); chunk >= 1 && attempts;) {
+        auto removed = false;
+        for (auto start = size_t { 0 }; start < ops.size() && attempts;) {
+            auto candidate = ops;
+            candidate.erase(candidate.begin() + start, candidate.begin() + std::min(start + chunk, candidate.size()));
+            if (fails(candidate)) {
+                ops = std::move(candidate);
+                removed = true;
+            } else {
+                start += chunk;
+            }
+        }
+        if (!removed) {
+            if (chunk == 1) {
+                break;
+            }
+            chunk /= 2;
+        }
+    }
+
+    // simplify arguments: try 0, then halving
+    for (auto& op : ops) {
+        for (auto* arg : { &op.a, &op.b }) {
+            while (*arg && attempts) {
+                const auto old = *arg;
+                *arg = 0;
+                if (fails(ops)) {
+                    break;
+                }
+                *arg = old / 2;
+                if (!fails(ops)) {
+                    *arg = old;
+                    break;
+                }
+            }
+        }
+        for (auto code = uint8_t { 0 }; code < op.code && attempts; code++) {
+            const auto old = op.code;
+            op.code = code;
+            if (fails(ops)) {
+                break;
+            }
+            op.code = old;
+        }
+    }
+    return ops;
+}
+
+// random op streams until one fails, then shrink it
+template<typename Model> std::optional<fuzz_failure> fuzz_differential(const fuzz_options& options = {}) {
+    auto rng = std::mt19937_64 { options.seed };
+    for (auto run = size_t { 0 }; run < options.runs; run++) {
+        // vary the argument range per run, small ranges collide more
+        const auto range = uint32_t { 1 } << (rng() % 12 + 1);
+        auto ops = std::vector<fuzz_op>(options.ops_per_run);
+        for (auto& op : ops) {
+            op = { uint8_t(rng() % Model::op_count), uint32_t(rng() % range), uint32_t(rng()) };
+        }
+        if (auto message = fuzz_run<Model>(ops, options.check_every)) {
+            auto failure = fuzz_failure {};
+            failure.original_size = ops.size();
+            failure.seed = options.seed;
+            failure.ops = fuzz_shrink<Model>(std::move(ops), options);
+            failure.message = fuzz_run<Model>(failure.ops, 1).value_or(*message);
+            for (auto& op : failure.ops) {
+                failure.described.push_back(fuzz_describe<Model>(op));
+            }
+            return failure;
+        }
+    }
+    return std::nullopt;
+}
+
+// libFuzzer entry point: abort on mismatch so the fuzzer saves the input
+#define JLIB_FUZZ_TARGET(Model)                                                                    \
+    extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {                      \
+        if (auto message = fuzz_run<Model>(fuzz_decode(data, size, Model::op_count), 1)) {         \
+            std::fprintf(stderr, "%s\n", message->c_str());                                        \
+            std::abort();                                                                          \
+        }                                                                                          \
+        return 0;                                                                                  \
+    }
@@ -3,9 +3,25 @@
 #include <ostream>
 #include <ratio>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <tuple>
 
+// s as a quoted JSON string, control characters become spaces
+inline void write_json_string(std::ostream& out, std::string_view s) {
+    out << '"';
+    for (auto c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
 template<typename T> concept Container = requires(T t) {
     { t.cbegin() } -> std::same_as<typename T::const_iterator>;
     { t.cend() } -> std::same_as<typename T::const_iterator>;
@@ -74,10 +74,13 @@ public:
         }
 
         // free node? inserting key for the first time, set key and hash
+        // tombstone? the key was erased, it counts again
         auto& n = nodes[node - &nodes[0]]; // hmm
         if (n.flags == Flags::Free) {
             n.hash = h;
             n.first = FORWARD(key);
+        }
+        if (n.flags != Flags::Busy) {
             count++;
         }
 
@@ -85,7 +85,7 @@ public:
     const_iterator get(auto&& key) const {
         const auto h = hash(FORWARD(key));
         const auto* indexptr = linear_probe(h, FORWARD(key));
-        if (!indexptr) {
+        if (!indexptr || !is_busy(*indexptr)) {
             return cend();
         }
         return cbegin() + (indexptr->s_ind & INDEX_BITS);
@@ -108,7 +108,7 @@ public:
                 for (auto p = 0; p < num_buckets; p++) {
                     const auto b = bucket(h + p);
                     auto& i = index[b];
-                    if ((i.s_ind & INDEX_BITS) == back) {
+                    if (is_busy(i) && (i.s_ind & INDEX_BITS) == back) {
                         i.s_ind = BUSY | (ind & INDEX_BITS);
                         break;
                     }
@@ -142,7 +142,8 @@ private:
         for (auto p = 0; p < num_buckets; p++) {
             const auto b = bucket(h + p);
             auto& i = index[b];
-            if (is_free(i) || (i.hash == h && cmp(nodes[i.s_ind & INDEX_BITS].first, FORWARD(key)))) {
+            // tombstones keep their hash but no longer point at a node
+            if (is_free(i) || (is_busy(i) && i.hash == h && cmp(nodes[i.s_ind & INDEX_BITS].first, FORWARD(key)))) {
                 return &i;
             }
         }
@@ -1,120 +1,397 @@
 #ifndef _HEAPSORT_H
 #define _HEAPSORT_H
 
+#include <algorithm>
 #include <array>
 #include <compare>
 #include <functional>
 #include <exception>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "static_stack.h"
 
-template<typename Type, typename Compare, typename Storage> struct heap {
+// d-ary heap
+// Compare(a, b) == true means a should be closer to the top than b
+// default arity is 4: shallower tree and children share a cache line, which
+// beats the binary heap for pop-heavy workloads
+template<typename Type, typename Compare, typename Storage, size_t Arity = 4> struct heap {
+    static_assert(Arity >= 2, "heap arity must be at least 2");
+
     Storage store;
     Compare compare;
 
     size_t get_count() const {
         return store.size();
     }
+    bool empty() const {
+        return get_count() == 0;
+    }
 
     // push a new element to the heap
-    void push(Type t) {
-        store.emplace_back(t);
+    void push(const Type& t) {
+        store.push_back(t);
+        sift_up(get_count() - 1);
+    }
+    void push(Type&& t) {
+        store.push_back(std::move(t));
+        sift_up(get_count() - 1);
+    }
+
+    // construct a new element in place
+    template<typename... Args> void emplace(Args&&... args) {
+        store.emplace_back(std::forward<Args>(args)...);
         sift_up(get_count() - 1);
     }
 
+    // peek the top element
+    const Type& top() const {
+        if (get_count() == 0) {
+            throw std::runtime_error("heap is empty");
+        }
+        return store[0];
+    }
+
     // pop an element
     Type pop() {
         if (get_count() == 0) {
             throw std::runtime_error("heap is empty");
         }
 
-        // return the top element
-        auto top = store[0];
-
-        // move the bottom element to the top and sift it down
-        swap_elements(get_count() - 1, 0);
+        // move the top element out, move the bottom element to the top and sift it down
+        auto top = std::move(store[0]);
+        const auto last = get_count() - 1;
+        if (last != 0) {
+            store[0] = std::move(store[last]);
+        }
         store.pop_back();
         sift_down(0);
 
         return top;
     }
 
-private:
-    void swap_elements(size_t i1, size_t i2) {
-        std::swap(store[i1], store[i2]);
+    // replace the top element and restore the heap condition
+    // cheaper than pop() followed by push(), only one sift
+    void replace_top(Type t) {
+        if (get_count() == 0) {
+            throw std::runtime_error("heap is empty");
+        }
+        store[0] = std::move(t);
+        sift_down(0);
     }
 
+private:
     // sift up the element at index until it satisfies heap condition (<= parent, >= child)
-    // tail recursive with no destructore, compiler should optimize into loop
+    // moves the element into a hole instead of swapping at every level
     void sift_up(size_t index) {
         if (index >= get_count() || index == 0) {
             return;
         }
-        auto parent_index = (index - 1) / 2;
-        if (compare(store[index], store[parent_index])) {
-            swap_elements(index, parent_index);
+        auto value = std::move(store[index]);
+        while (index > 0) {
+            const auto parent_index = (index - 1) / Arity;
+            if (!compare(value, store[parent_index])) {
+                break;
+            }
+            store[index] = std::move(store[parent_index]);
             index = parent_index;
-            sift_up(parent_index);
         }
+        store[index] = std::move(value);
     }
 
     // sift down the element at index until it satisfies heap condition (<= parent, >= child)
-    // tail recursive with no destructors, compiler should optimize into loop
     void sift_down(size_t index) {
-        if (index >= get_count()) {
+        const auto count = get_count();
+        if (index >= count) {
             return;
         }
-        auto child1_index = index * 2 + 1;
-        auto child2_index = child1_index + 1;
-        auto next_index = child1_index; // 1 child case default
+        auto value = std::move(store[index]);
+        while (true) {
+            const auto first_child = index * Arity + 1;
+            if (first_child >= count) {
+                break; // 0 child case
+            }
 
-        if (child1_index > get_count() - 1) {
-            return; // 0 child case
-        } else if (child2_index <= get_count() - 1) {
-            // 2 children; the larger child should sift up
-            next_index = compare(store[child1_index], store[child2_index]) ? child1_index : child2_index;
-        }
+            // find the child that should be nearest the top
+            const auto last_child = std::min(first_child + Arity, count);
+            auto next_index = first_child;
+            for (auto c = first_child + 1; c < last_child; c++) {
+                if (compare(store[c], store[next_index])) {
+                    next_index = c;
+                }
+            }
 
-        // compare with next_index
-        if (compare(store[index], store[next_index])) {
-            return;
-        } else {
-            swap_elements(index, next_index);
-            sift_down(next_index);
+            if (!compare(store[next_index], value)) {
+                break;
+            }
+            store[index] = std::move(store[next_index]);
+            index = next_index;
         }
+        store[index] = std::move(value);
     }
 };
 
 // dynamic heap
-template<typename Type, typename Compare = std::greater<Type>> using dynamic_heap = heap<Type, Compare, std::vector<Type>>;
+template<typename Type, typename Compare = std::greater<Type>, size_t Arity = 4>
+using dynamic_heap = heap<Type, Compare, std::vector<Type>, Arity>;
 
 // static heap
-template<typename Type, size_t N, typename Compare = std::greater<Type>>
-using static_heap = heap<Type, Compare, static_stack<Type, N>>;
+template<typename Type, size_t N, typename Compare = std::greater<Type>, size_t Arity = 4>
+using static_heap = heap<Type, Compare, static_stack<Type, N>, Arity>;
+
+// indexed heap
+// like dynamic_heap, but push() returns a stable handle to the element
+// which can be used to change its priority or remove it in O(log n)
+// handles of popped/erased elements are recycled by later pushes
+template<typename Type, typename Compare = std::greater<Type>, size_t Arity = 4> class indexed_heap {
+    static_assert(Arity >= 2, "heap arity must be at least 2");
+
+public:
+    using handle = size_t;
+
+    size_t get_count() const {
+        return store.size();
+    }
+    bool empty() const {
+        return store.empty();
+    }
+    bool contains(handle h) const {
+        return h < positions.size() && positions[h] != npos;
+    }
+
+    handle push(const Type& t) {
+        return emplace(t);
+    }
+    handle push(Type&& t) {
+        return emplace(std::move(t));
+    }
+    template<typename... Args> handle emplace(Args&&... args) {
+        auto h = handle { 0 };
+        if (free_handles.size()) {
+            h = free_handles.back();
+            free_handles.pop_back();
+        } else {
+            h = positions.size();
+            positions.emplace_back(npos);
+        }
+        store.emplace_back(Node { Type(std::forward<Args>(args)...), h });
+        positions[h] = store.size() - 1;
+        sift_up(store.size() - 1);
+        return h;
+    }
+
+    const Type& top() const {
+        if (empty()) {
+            throw std::runtime_error("heap is empty");
+        }
+        return store[0].value;
+    }
+    handle top_handle() const {
+        if (empty()) {
+            throw std::runtime_error("heap is empty");
+        }
+        return store[0].h;
+    }
+
+    // get the current value for a handle
+    const Type& get(handle h) const {
+        return store[position(h)].value;
+    }
+
+    Type pop() {
+        if (empty()) {
+            throw std::runtime_error("heap is empty");
+        }
+        return remove_at(0);
+    }
+
+    // remove the element with handle h and return it
+    Type erase(handle h) {
+        return remove_at(position(h));
+    }
+
+    // replace the value for h and restore the heap condition in whichever direction is needed
+    void update(handle h, Type t) {
+        const auto index = position(h);
+        const auto up = compare(t, store[index].value);
+        store[index].value = std::move(t);
+        if (up) {
+            sift_up(index);
+        } else {
+            sift_down(index);
+        }
+    }
+
+    // move h towards the top; the new value must not compare worse than the old one
+    // ("decrease" in the min-heap sense, ie. with Compare = std::less)
+    void decrease_key(handle h, Type t) {
+        const auto index = position(h);
+        if (compare(store[index].value, t)) {
+            throw std::runtime_error("decrease_key would move element away from the top");
+        }
+        store[index].value = std::move(t);
+        sift_up(index);
+    }
+
+    void clear() {
+        store.clear();
+        positions.clear();
+        free_handles.clear();
+    }
+
+private:
+    static constexpr size_t npos = size_t(-1);
+
+    struct Node {
+        Type value;
+        handle h;
+    };
+
+    std::vector<Node> store;
+    std::vector<size_t> positions; // handle -> index in store
+    std::vector<handle> free_handles;
+    Compare compare;
+
+    size_t position(handle h) const {
+        if (!contains(h)) {
+            throw std::runtime_error("invalid heap handle");
+        }
+        return positions[h];
+    }
+
+    Type remove_at(size_t index) {
+        auto node = std::move(store[index]);
+        positions[node.h] = npos;
+        free_handles.emplace_back(node.h);
+
+        const auto last = store.size() - 1;
+        if (index != last) {
+            store[index] = std::move(store[last]);
+            positions[store[index].h] = index;
+            store.pop_back();
+            // the moved element may need to go either way
+            if (index > 0 && compare(store[index].value, store[(index - 1) / Arity].value)) {
+                sift_up(index);
+            } else {
+                sift_down(index);
+            }
+        } else {
+            store.pop_back();
+        }
+        return std::move(node.value);
+    }
+
+    void place(size_t index, Node&& node) {
+        positions[node.h] = index;
+        store[index] = std::move(node);
+    }
+
+    void sift_up(size_t index) {
+        auto node = std::move(store[index]);
+        while (index > 0) {
+            const auto parent_index = (index - 1) / Arity;
+            if (!compare(node.value, store[parent_index].value)) {
+                break;
+            }
+            place(index, std::move(store[parent_index]));
+            index = parent_index;
+        }
+        place(index, std::move(node));
+    }
+
+    void sift_down(size_t index) {
+        const auto count = store.size();
+        auto node = std::move(store[index]);
+        while (true) {
+            const auto first_child = index * Arity + 1;
+            if (first_child >= count) {
+                break;
+            }
+            const auto last_child = std::min(first_child + Arity, count);
+            auto next_index = first_child;
+            for (auto c = first_child + 1; c < last_child; c++) {
+                if (compare(store[c].value, store[next_index].value)) {
+                    next_index = c;
+                }
+            }
+            if (!compare(store[next_index].value, node.value)) {
+                break;
+            }
+            place(index, std::move(store[next_index]));
+            index = next_index;
+        }
+        place(index, std::move(node));
+    }
+};
+
+// in-place heapsort helpers
+// builds a heap with the comparison reversed so the element that belongs last is on top,
+// then repeatedly swaps the top to the end of the shrinking range
+template<size_t Arity, typename It, typename Compare>
+void heapsort_sift_down(It first, size_t count, size_t index, Compare& compare) {
+    auto value = std::move(first[index]);
+    while (true) {
+        const auto first_child = index * Arity + 1;
+        if (first_child >= count) {
+            break;
+        }
+        const auto last_child = std::min(first_child + Arity, count);
+        auto next_index = first_child;
+        for (auto c = first_child + 1; c < last_child; c++) {
+            if (compare(first[next_index], first[c])) {
+                next_index = c;
+            }
+        }
+        if (!compare(value, first[next_index])) {
+            break;
+        }
+        first[index] = std::move(first[next_index]);
+        index = next_index;
+    }
+    first[index] = std::move(value);
+}
+
+// in-place heapsort over a random access range
+// afterwards the range is ordered like std::sort(first, last, compare)
+// no allocation, O(n log n) worst case, not stable
+template<std::random_access_iterator It, typename Compare = std::greater<>, size_t Arity = 4>
+void heapsort(It first, It last, Compare compare = {}) {
+    const auto count = size_t(last - first);
+    if (count < 2) {
+        return;
+    }
+    for (auto i = (count - 2) / Arity + 1; i-- > 0;) {
+        heapsort_sift_down<Arity>(first, count, i, compare);
+    }
+    for (auto end = count - 1; end > 0; end--) {
+        std::iter_swap(first, first + end);
+        heapsort_sift_down<Arity>(first, end, 0, compare);
+    }
+}
+
+// in-place heapsort for span
+template<typename Type, size_t Extent, typename Compare = std::greater<>>
+void heapsort(std::span<Type, Extent> data, Compare compare = {}) {
+    heapsort(data.begin(), data.end(), compare);
+}
 
 // heapsort for array
 template<typename Type, size_t N, typename Compare = std::greater<Type>>
 void heapsort(const std::array<Type, N>& input, std::array<Type, N>& output) {
-    auto h = static_heap<Type, N, Compare> {};
-    for (auto i : input) {
-        h.push(i);
-    }
-    for (auto i = 0u; i < N; i++) {
-        output[i] = h.pop();
-    }
+    output = input;
+    heapsort(output.begin(), output.end(), Compare {});
 }
 
 // heapsort for vector
+// sorted elements are appended to output
 template<typename Type, typename Compare = std::greater<Type>>
 void heapsort(const std::vector<Type>& input, std::vector<Type>& output) {
-    auto h = dynamic_heap<Type, Compare> {};
-    for (auto& i : input) {
-        h.push(i);
-    }
-    for (auto i = 0u; i < input.size(); i++) {
-        output.emplace_back(h.pop());
-    }
+    const auto offset = output.size();
+    output.insert(output.end(), input.begin(), input.end());
+    heapsort(output.begin() + offset, output.end(), Compare {});
 }
 
 #endif
@@ -0,0 +1,225 @@
+// histogram.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+/*
+latency_histogram<Precision>
+
+fixed memory log-linear histogram for latencies, in the spirit of HdrHistogram
+values below 2^Precision get a bucket each, above that every power of two range
+is split into 2^(Precision-1) equal buckets, so the relative error of any
+reported value is at most 2^-(Precision-1) (under 1.6% for the default of 7)
+covers the whole uint64_t range, 3776 counters for the default precision
+
+    - record: O(1), a bit_width and a shift
+    - value_at_quantile / percentile: O(buckets), returns the top of the bucket, clamped to max()
+    - merge: add another histogram's counts, e.g. one per thread
+
+concurrent_latency_histogram<Precision>
+
+the same, shared between threads: each thread records into its own shard with
+relaxed atomics (no locks, no contended cache lines for up to Shards threads),
+snapshot() merges the shards into a plain latency_histogram for queries
+*/
+
+namespace histogram_detail {
+
+template<size_t Precision> struct layout {
+    static_assert(Precision >= 2 && Precision <= 16, "latency_histogram precision out of range");
+    static constexpr size_t linear = size_t { 1 } << Precision;
+    static constexpr size_t half = linear / 2;
+    static constexpr size_t buckets = (66 - Precision) * half;
+
+    static constexpr size_t index(uint64_t v) {
+        if (v < linear) {
+            return size_t(v);
+        }
+        const auto shift = size_t(std::bit_width(v)) - Precision;
+        return shift * half + size_t(v >> shift);
+    }
+    // smallest value that lands in bucket i
+    static constexpr uint64_t lowest(size_t i) {
+        if (i < linear) {
+            return i;
+        }
+        const auto shift = i / half - 1;
+        return uint64_t(i % half + half) << shift;
+    }
+    // largest value that lands in bucket i
+    static constexpr uint64_t highest(size_t i) {
+        return i + 1 == buckets ? UINT64_MAX : lowest(i + 1) - 1;
+    }
+};
+
+} // namespace histogram_detail
+
+template<size_t Precision = 7> class latency_histogram {
+    using layout = histogram_detail::layout<Precision>;
+
+public:
+    static constexpr size_t bucket_count = layout::buckets;
+
+    void record(uint64_t value, uint64_t n = 1) {
+        counts[layout::index(value)] += n;
+        total += n;
+        sum += value * n;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+    bool empty() const {
+        return total == 0;
+    }
+    uint64_t min() const {
+        return total ? min_value : 0;
+    }
+    uint64_t max() const {
+        return max_value;
+    }
+    double mean() const {
+        return total ? double(sum) / double(total) : 0.0;
+    }
+
+    // q in [0, 1]: the smallest recorded value v such that at least q of all values are <= v,
+    // up to the bucket resolution
+    uint64_t value_at_quantile(double q) const {
+        if (total == 0) {
+            return 0;
+        }
+        q = std::clamp(q, 0.0, 1.0);
+        const auto target = std::max(uint64_t { 1 }, uint64_t(q * double(total) + 0.5));
+        auto seen = uint64_t { 0 };
+        for (auto i = layout::index(min_value); i < bucket_count; i++) {
+            seen += counts[i];
+            if (seen >= target) {
+                return std::clamp(layout::highest(i), min_value, max_value);
+            }
+        }
+        return max_value;
+    }
+    // p in [0, 100]
+    uint64_t percentile(double p) const {
+        return value_at_quantile(p / 100.0);
+    }
+
+    void merge(const latency_histogram& other) {
+        if (other.total == 0) {
+            return;
+        }
+        for (auto i = size_t { 0 }; i < bucket_count; i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        min_value = std::min(min_value, other.min_value);
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    void reset() {
+        *this = latency_histogram {};
+    }
+
+    // f(lowest, highest, count) for every non-empty bucket, in increasing order
+    template<typename F> void for_each_bucket(F&& f) const {
+        for (auto i = size_t { 0 }; i < bucket_count; i++) {
+            if (counts[i]) {
+                f(layout::lowest(i), layout::highest(i), counts[i]);
+            }
+        }
+    }
+
+    static constexpr uint64_t bucket_lowest(uint64_t value) {
+        return layout::lowest(layout::index(value));
+    }
+    static constexpr uint64_t bucket_highest(uint64_t value) {
+        return layout::highest(layout::index(value));
+    }
+
+private:
+    template<size_t, size_t> friend class concurrent_latency_histogram;
+
+    std::array<uint64_t, bucket_count> counts = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t min_value = UINT64_MAX;
+    uint64_t max_value = 0;
+};
+
+// a small per-thread number, used to pick a shard
+inline size_t histogram_thread_index() {
+    static auto next = std::atomic<size_t> { 0 };
+    thread_local const auto index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+template<size_t Precision = 7, size_t Shards = 16> class concurrent_latency_histogram {
+    using layout = histogram_detail::layout<Precision>;
+    static_assert(std::has_single_bit(Shards), "shard count must be a power of two");
+
+    struct alignas(64) shard {
+        std::array<std::atomic<uint64_t>, layout::buckets> counts = {};
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> min_value = UINT64_MAX;
+        std::atomic<uint64_t> max_value = 0;
+    };
+
+public:
+    concurrent_latency_histogram(): shards(std::make_unique<shard[]>(Shards)) {}
+
+    void record(uint64_t value, uint64_t n = 1) {
+        auto& s = shards[histogram_thread_index() & (Shards - 1)];
+        s.counts[layout::index(value)].fetch_add(n, std::memory_order_relaxed);
+        s.sum.fetch_add(value * n, std::memory_order_relaxed);
+        // usually already settled, so check before paying for the read-modify-write
+        auto lo = s.min_value.load(std::memory_order_relaxed);
+        while (value < lo && !s.min_value.compare_exchange_weak(lo, value, std::memory_order_relaxed))
+            ;
+        auto hi = s.max_value.load(std::memory_order_relaxed);
+        while (value > hi && !s.max_value.compare_exchange_weak(hi, value, std::memory_order_relaxed))
+            ;
+    }
+
+    // a consistent-enough copy while other threads keep recording:
+    // every count is exact, but records racing with the snapshot may be half included
+    latency_histogram<Precision> snapshot() const {
+        auto h = latency_histogram<Precision> {};
+        for (auto i = size_t { 0 }; i < Shards; i++) {
+            auto& s = shards[i];
+            for (auto b = size_t { 0 }; b < layout::buckets; b++) {
+                const auto c = s.counts[b].load(std::memory_order_relaxed);
+                h.counts[b] += c;
+                h.total += c;
+            }
+            h.sum += s.sum.load(std::memory_order_relaxed);
+            h.min_value = std::min(h.min_value, s.min_value.load(std::memory_order_relaxed));
+            h.max_value = std::max(h.max_value, s.max_value.load(std::memory_order_relaxed));
+        }
+        return h;
+    }
+
+    // not safe against concurrent record
+    void reset() {
+        for (auto i = size_t { 0 }; i < Shards; i++) {
+            auto& s = shards[i];
+            for (auto& c : s.counts) {
+                c.store(0, std::memory_order_relaxed);
+            }
+            s.sum.store(0, std::memory_order_relaxed);
+            s.min_value.store(UINT64_MAX, std::memory_order_relaxed);
+            s.max_value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::unique_ptr<shard[]> shards;
+};
@@ -1,19 +1,33 @@
 #pragma once
 
 #include "binary_file.h"
+#include "mapped_file.h"
 #include "text_file.h"
 
 #include "defer.h"
 #include "jenum.h"
+#include "perf_counters.h"
+#include "profile.h"
 
 #include "dag.h"
+#include "concurrent_heap.h"
 #include "hash_map.h"
 #include "heapsort.h"
+#include "histogram.h"
+#include "parallel_sort.h"
 #include "static_stack.h"
 #include "swiss_vector.h"
+#include "task_engine.h"
+#include "top_k.h"
 
 #include "generic_ostream.h"
 #include "log.h"
+#include "log_async.h"
+#include "log_binary.h"
+#include "log_file.h"
 #include "terminal_color.h"
 
+#include "bench_framework.h"
+#include "bench_report.h"
+#include "fuzz.h"
 #include "test_framework.h"
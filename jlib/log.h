@@ -1,9 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ios>
 #include <sstream>
 #include <cstdint>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "generic_ostream.h"
 #include "terminal_color.h"
@@ -25,7 +39,10 @@ struct log_pad {
 
 #define QUOTE quote {} |
 template<char Q = '\''> struct quote {};
-template<typename T, char Q> struct quotewrap { const T& t; };
+template<typename T, char Q> struct quotewrap {
+    static constexpr char quote_char = Q;
+    const T& t;
+};
 template<typename T, char Q='\''> quotewrap<T,Q> operator|(const quote<Q>& /*q*/, const T& t) {
     return quotewrap<T, Q> { t };
 }
@@ -33,6 +50,71 @@ template<typename T, char Q> std::ostream& operator<<(std::ostream& o, const quo
     return o << Q << q.t << Q;
 }
 
+// reusable formatting buffer
+// log() formats into a thread-local one of these, so a log line doesn't allocate once the
+// buffer has grown to fit; numbers go through to_chars rather than iostreams
+// types without a fast path fall back to their operator<< via the buffer's own ostringstream,
+// and so does the rest of the line after any manipulator other than hex/oct/dec
+// (boolalpha, fixed, setprecision...), so those format exactly as they would on an ostream
+struct log_buffer {
+    std::string data;
+    size_t line_start = 0; // log_pad counts from here
+    int base = 10; // std::hex, std::oct, std::dec, while not streaming
+    bool streaming = false; // everything goes through stream until the next begin()
+    bool busy = false;
+    std::unique_ptr<std::ostringstream> stream; // created on first use
+
+    void begin() {
+        data.clear();
+        line_start = 0;
+        reset_format();
+    }
+
+    // default formatting again, as on a fresh ostream
+    void reset_format() {
+        base = 10;
+        if (streaming) {
+            stream->flags(std::ios_base::skipws | std::ios_base::dec);
+            stream->precision(6);
+            stream->width(0);
+            stream->fill(' ');
+            streaming = false;
+        }
+    }
+
+    std::ostringstream& formatter() {
+        if (!stream) {
+            stream = std::make_unique<std::ostringstream>();
+        }
+        return *stream;
+    }
+
+    // hand the rest of the line to the ostream, carrying over the base
+    void start_streaming() {
+        auto& s = formatter();
+        s << (base == 16 ? std::hex : base == 8 ? std::oct : std::dec);
+        streaming = true;
+    }
+
+    template<typename T> void stream_format(const T& arg) {
+        auto& s = formatter();
+        s.str({});
+        s << arg;
+        data += s.view();
+    }
+};
+
+// the <iomanip> manipulators, which unlike std::hex & co. aren't plain functions
+template<typename T> constexpr bool log_is_iomanip = std::is_same_v<T, decltype(std::setprecision(0))>
+    || std::is_same_v<T, decltype(std::setw(0))> || std::is_same_v<T, decltype(std::setbase(0))>
+    || std::is_same_v<T, decltype(std::setfill(' '))> || std::is_same_v<T, decltype(std::setiosflags({}))>
+    || std::is_same_v<T, decltype(std::resetiosflags({}))>;
+
+inline log_buffer& thread_log_buffer() {
+    thread_local auto buffer = log_buffer {};
+    return buffer;
+}
+
 std::ostream& operator<<(std::ostream& o, const uint8_t& arg);
 std::ostream& operator<<(std::ostream& o, const log_pad& align);
 std::ostream& log_stream(std::ostream& o, const std::string& arg);
@@ -42,10 +124,78 @@ template<typename Arg> std::ostream& log_stream(std::ostream& o, const Arg& arg)
     return o << arg;
 }
 
-template<bool Space, typename Arg> std::ostream& log_sp(std::ostream& o, Arg&& arg) {
+// integer to text, no allocation once the string has capacity
+template<typename T> void log_append_int(std::string& out, T value, int base) {
+    char chars[72];
+    out.append(chars, std::to_chars(chars, chars + sizeof(chars), value, base).ptr);
+}
+
+template<typename Arg> log_buffer& log_stream(log_buffer& b, const Arg& arg) {
+    using T = std::remove_cvref_t<Arg>;
+    using manipulator = std::ios_base& (*)(std::ios_base&);
+    if constexpr (std::is_same_v<T, log_pad>) {
+        while (b.data.size() - b.line_start < arg.n) {
+            b.data += arg.ch;
+        }
+        return b;
+    } else if constexpr (requires { T::quote_char; arg.t; }) {
+        log_stream(b, T::quote_char);
+        log_stream(b, arg.t);
+        log_stream(b, T::quote_char);
+        return b;
+    }
+    if (b.streaming) {
+        b.stream_format(arg);
+        return b;
+    }
+    if constexpr (std::is_same_v<T, bool>) {
+        b.data += arg ? '1' : '0';
+    } else if constexpr (std::is_same_v<T, char>) {
+        b.data += arg;
+    } else if constexpr (std::is_same_v<T, Colors::Codes>) {
+        b.data += "\033[";
+        log_append_int(b.data, int(arg), 10);
+        b.data += 'm';
+    } else if constexpr (std::is_same_v<T, signed char>) {
+        // int8_t is a character to ostream, there's no overload for it like uint8_t's
+        b.data += char(arg);
+    } else if constexpr (std::is_integral_v<T>) {
+        // uint8_t is printed as a number, same as the ostream overload
+        // ostream prints negative numbers in hex and oct as two's complement, not with a minus sign
+        using U = std::conditional_t<sizeof(T) == 1, int, T>;
+        if (b.base != 10 && std::is_signed_v<U>) {
+            log_append_int(b.data, std::make_unsigned_t<U>(arg), b.base);
+        } else {
+            log_append_int(b.data, U(arg), b.base);
+        }
+    } else if constexpr (std::is_floating_point_v<T>) {
+        // general format with precision 6 matches the ostream default
+        char chars[64];
+        b.data.append(chars, std::to_chars(chars, chars + sizeof(chars), arg, std::chars_format::general, 6).ptr);
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        b.data += std::string_view { arg };
+    } else if constexpr (std::is_convertible_v<const T&, manipulator>) {
+        const auto m = manipulator(arg);
+        if (m == manipulator(std::hex) || m == manipulator(std::oct) || m == manipulator(std::dec)) {
+            b.base = m == manipulator(std::hex) ? 16 : m == manipulator(std::oct) ? 8 : 10;
+        } else {
+            b.start_streaming();
+            b.stream_format(m);
+        }
+    } else {
+        // also a non-default base, which the type's operator<< may print integers in
+        if (log_is_iomanip<T> || b.base != 10) {
+            b.start_streaming();
+        }
+        b.stream_format(arg);
+    }
+    return b;
+}
+
+template<bool Space, typename Out, typename Arg> Out& log_sp(Out& o, Arg&& arg) {
     return log_stream(o, std::forward<Arg>(arg));
 }
-template<bool Space, typename First, typename... Args> std::ostream& log_sp(std::ostream& o, First&& first, Args&&... args) {
+template<bool Space, typename Out, typename First, typename... Args> Out& log_sp(Out& o, First&& first, Args&&... args) {
     log_stream(o, first);
 
     using first_t = std::decay_t<First>;
@@ -53,12 +203,12 @@ template<bool Space, typename First, typename... Args> std::ostream& log_sp(std:
         && !std::is_same_v<first_t, Colors::Codes>
         && !std::is_same_v<first_t, decltype(std::hex)>
     ) {
-        o << ' ';
+        log_stream(o, ' ');
     }
     return log_sp<Space>(o, std::forward<Args>(args)...);
 }
 
-template<bool Space, bool Prefix, typename... Args> std::ostream& log_pf(std::ostream& o, Args&&... args) {
+template<bool Space, bool Prefix, typename Out, typename... Args> Out& log_pf(Out& o, Args&&... args) {
     if constexpr (Prefix) {
         return log_sp<Space>(o, "LOG:", std::forward<Args>(args)..., '\n');
     } else {
@@ -66,16 +216,262 @@ template<bool Space, bool Prefix, typename... Args> std::ostream& log_pf(std::os
     }
 }
 
+// log output destination
+// log_write() hands every formatted line (or batch of lines, for the async loggers) to each sink
+// sinks are called from any thread that logs and must do their own locking
+struct log_sink {
+    virtual ~log_sink() = default;
+    virtual void write(std::string_view str) = 0;
+    virtual void flush() {}
+};
+
+// the default sink
+// std::cerr is unbuffered, so this is one write() per call
+struct stderr_log_sink final : public log_sink {
+    void write(std::string_view str) override;
+};
+
+// sinks are swapped copy-on-write, so changing them never blocks log_write() for longer than a pointer copy
+// (the list is a std::atomic<std::shared_ptr>, which isn't lock-free in libstdc++: it guards the
+// copy with a short internal spin lock)
+void add_log_sink(std::shared_ptr<log_sink> sink);
+void remove_log_sink(const std::shared_ptr<log_sink>& sink);
+void set_log_sinks(std::vector<std::shared_ptr<log_sink>> sinks);
+void flush_log_sinks();
+
+// construct the sink list now, if nothing has yet
+// statics are destroyed in reverse order of construction, so objects that log from their destructor
+// (the async loggers flush at exit) call this in their constructor to keep the sinks alive until they're gone
+void init_log_sinks();
+
+// write already formatted text to every sink
+// (or to this thread's capture, see below)
+void log_write(std::string_view str);
+
+// divert log output from the current thread into a string instead of the sinks
+// e.g. so tests running in parallel don't interleave their output
+// only covers this thread: threads it starts, and the async logger, still write to the sinks
+inline std::string*& thread_log_capture() {
+    thread_local std::string* capture = nullptr;
+    return capture;
+}
+
+struct log_capture_scope {
+    std::string text;
+
+    log_capture_scope(): previous(std::exchange(thread_log_capture(), &text)) {}
+    log_capture_scope(const log_capture_scope&) = delete;
+    log_capture_scope& operator=(const log_capture_scope&) = delete;
+    ~log_capture_scope() {
+        thread_log_capture() = previous;
+    }
+
+private:
+    std::string* previous;
+};
+
+// format a log line into b's buffer; b.data holds the result
+template<bool Space=true, bool Prefix=true, typename...Args> void log_format(log_buffer& b, Args&&... args) {
+    b.begin();
+    log_pf<Space, Prefix>(b, std::forward<Args>(args)...);
+}
+
 template<bool Space=true, bool Prefix=true, typename...Args> void log(Args&&... args) {
-    auto s = std::ostringstream {};
-    log_pf<Space, Prefix>(s, std::forward<Args>(args)...);
-    const auto str = s.str();
-    std::cerr << str;
-#ifdef JLIB_LOG_VISUALSTUDIO
-    OutputDebugString(str.c_str());
+    auto& b = thread_log_buffer();
+    if (b.busy) {
+        // an argument's operator<< is logging, don't clobber the line being built
+        auto nested = log_buffer {};
+        log_format<Space, Prefix>(nested, std::forward<Args>(args)...);
+        log_write(nested.data);
+        return;
+    }
+    struct busy_guard {
+        log_buffer& b;
+        busy_guard(log_buffer& b): b(b) { b.busy = true; }
+        ~busy_guard() { b.busy = false; }
+    } guard { b };
+    log_format<Space, Prefix>(b, std::forward<Args>(args)...);
+    log_write(b.data);
+}
+
+// log levels
+//
+// LOG_TRACE/LOG_DEBUG/LOG_INFO/LOG_WARN/LOG_ERROR(...) log with a level prefix ("INFO: ...")
+//  - compile time: sites below JLIB_LOG_MIN_LEVEL (0 = trace .. 5 = off) compile to nothing
+//  - run time: sites below log_threshold() are skipped before any argument is evaluated
+//  - per module: LOG_M(module, level, ...) checks the module's own level if one was set,
+//      the global threshold otherwise
+//
+//  inline auto net_log = log_module { "net" };
+//  LOG_M(net_log, debug, "connected to", address);
+//  set_log_levels("warn,net=debug");
+enum class log_level : uint8_t {
+    trace,
+    debug,
+    info,
+    warn,
+    error,
+    off,
+};
+
+#ifndef JLIB_LOG_MIN_LEVEL
+#define JLIB_LOG_MIN_LEVEL 0
 #endif
+constexpr auto log_min_level = log_level(JLIB_LOG_MIN_LEVEL);
+
+// global runtime threshold, defaults to info
+std::atomic<log_level>& log_threshold();
+
+inline bool log_enabled(log_level level) {
+    return level >= log_threshold().load(std::memory_order_relaxed);
 }
 
+std::string_view log_level_name(log_level level);
+bool log_level_from_name(std::string_view name, log_level& out);
+
+// named group of log sites with an optional level override
+// declare at namespace scope, modules register themselves so they can be configured by name
+struct log_module {
+    explicit log_module(const char* name);
+    ~log_module();
+    log_module(const log_module&) = delete;
+    log_module& operator=(const log_module&) = delete;
+
+    const char* name;
+
+    void set_level(log_level level) {
+        override_level.store(uint8_t(level), std::memory_order_relaxed);
+    }
+    // go back to following the global threshold
+    void reset_level() {
+        override_level.store(inherit, std::memory_order_relaxed);
+    }
+    bool enabled(log_level level) const {
+        const auto o = override_level.load(std::memory_order_relaxed);
+        return o == inherit ? log_enabled(level) : uint8_t(level) >= o;
+    }
+
+private:
+    static constexpr uint8_t inherit = 0xff;
+    std::atomic<uint8_t> override_level = inherit;
+};
+
+// set the level of a module by name; applies to modules registered later too
+void set_log_level(std::string_view module, log_level level);
+
+// configure from a string like "warn,net=debug,db=error"
+// entries without a module name set the global threshold
+// returns false (and applies nothing) if the spec doesn't parse
+bool set_log_levels(std::string_view spec);
+
+template<bool Space = true, typename... Args> void log_at(log_level level, Args&&... args) {
+    log<Space, false>(log_level_name(level), std::forward<Args>(args)...);
+}
+
+#define JLOG_IMPL(level, condition, ...)              \
+    do {                                             \
+        if constexpr (level >= log_min_level) {      \
+            if (condition) {                         \
+                log_at(level, __VA_ARGS__);          \
+            }                                        \
+        }                                            \
+    } while (0)
+#define JLOG(level, ...) JLOG_IMPL(log_level::level, log_enabled(log_level::level), __VA_ARGS__)
+#define LOG_M(module, level, ...) JLOG_IMPL(log_level::level, (module).enabled(log_level::level), __VA_ARGS__)
+#define LOG_TRACE(...) JLOG(trace, __VA_ARGS__)
+#define LOG_DEBUG(...) JLOG(debug, __VA_ARGS__)
+#define LOG_INFO(...) JLOG(info, __VA_ARGS__)
+#define LOG_WARN(...) JLOG(warn, __VA_ARGS__)
+#define LOG_ERROR(...) JLOG(error, __VA_ARGS__)
+
+// rate limiting and sampling
+//
+// LOG_RATE_LIMITED(level, per_second, burst, ...) at most per_second records on average, bursts of up to burst
+// LOG_EVERY_N(level, n, ...)                       the 1st, (n+1)th, (2n+1)th... record
+// LOG_SAMPLED(level, probability, ...)             each record with the given probability
+//
+// each call site gets its own static log_limiter; the level is checked first, so disabled
+// sites don't count as dropped; the next record that gets through reports "(dropped N)"
+struct log_dropped {
+    uint64_t n = 0;
+};
+inline std::ostream& operator<<(std::ostream& o, const log_dropped& d) {
+    return o << "(dropped " << d.n << ')';
+}
+template<> inline log_buffer& log_stream(log_buffer& b, const log_dropped& d) {
+    b.data += "(dropped ";
+    log_append_int(b.data, d.n, 10);
+    b.data += ')';
+    return b;
+}
+
+struct log_limiter {
+    std::atomic<uint64_t> next = 0; // rate: theoretical arrival time (GCRA), every_n: counter
+    std::atomic<uint64_t> dropped = 0;
+
+    // generic cell rate algorithm: a token bucket in a single atomic
+    // a rate that isn't positive (or is NaN) never allows; tiny rates are capped at one per ~30 years
+    bool allow_rate(double per_second, uint32_t burst) {
+        if (!(per_second > 0)) {
+            return drop();
+        }
+        constexpr auto max_interval = 1e18;
+        const auto interval = uint64_t(std::min(1e9 / per_second, max_interval));
+        burst = std::max(burst, 1u);
+        const auto limit = interval > UINT64_MAX / burst ? UINT64_MAX : interval * burst;
+        const auto now = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        auto tat = next.load(std::memory_order_relaxed);
+        while (true) {
+            const auto next_tat = std::max(tat, now) + interval;
+            if (next_tat - now > limit) {
+                return drop();
+            }
+            if (next.compare_exchange_weak(tat, next_tat, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+    bool allow_every_n(uint64_t n) {
+        return next.fetch_add(1, std::memory_order_relaxed) % std::max(n, uint64_t { 1 }) == 0 || drop();
+    }
+    bool allow_sampled(double probability) {
+        thread_local auto state = uint64_t(std::hash<std::thread::id> {}(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return double(state >> 11) * 0x1.0p-53 < probability || drop();
+    }
+
+    // records dropped since the last call
+    uint64_t take_dropped() {
+        return dropped.load(std::memory_order_relaxed) ? dropped.exchange(0, std::memory_order_relaxed) : 0;
+    }
+
+private:
+    bool drop() {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+#define JLOG_LIMITED_IMPL(level, allow, ...)                                                \
+    do {                                                                                   \
+        if constexpr (log_level::level >= log_min_level) {                                 \
+            static auto _jlib_limiter = log_limiter {};                                    \
+            if (log_enabled(log_level::level) && _jlib_limiter.allow) {                    \
+                if (const auto _jlib_dropped = _jlib_limiter.take_dropped()) {             \
+                    log_at(log_level::level, __VA_ARGS__, log_dropped { _jlib_dropped });  \
+                } else {                                                                   \
+                    log_at(log_level::level, __VA_ARGS__);                                 \
+                }                                                                          \
+            }                                                                              \
+        }                                                                                  \
+    } while (0)
+#define LOG_RATE_LIMITED(level, per_second, burst, ...) JLOG_LIMITED_IMPL(level, allow_rate(per_second, burst), __VA_ARGS__)
+#define LOG_EVERY_N(level, n, ...) JLOG_LIMITED_IMPL(level, allow_every_n(n), __VA_ARGS__)
+#define LOG_SAMPLED(level, probability, ...) JLOG_LIMITED_IMPL(level, allow_sampled(probability), __VA_ARGS__)
+
 #ifdef JLIB_IMPLEMENTATION
 std::ostream& operator<<(std::ostream& o, const uint8_t& arg) {
     return o << (int)arg;
@@ -93,4 +489,158 @@ std::ostream& log_stream(std::ostream& o, const std::string& arg) {
 std::ostream& log_stream(std::ostream& o, const std::string_view& arg) {
     return o << arg;
 }
+std::atomic<log_level>& log_threshold() {
+    static auto threshold = std::atomic<log_level> { log_level::info };
+    return threshold;
+}
+
+std::string_view log_level_name(log_level level) {
+    static constexpr std::string_view names[] = { "TRACE:", "DEBUG:", "INFO:", "WARN:", "ERROR:", "OFF:" };
+    return names[std::min(size_t(level), std::size(names) - 1)];
+}
+
+bool log_level_from_name(std::string_view name, log_level& out) {
+    static constexpr std::string_view names[] = { "trace", "debug", "info", "warn", "error", "off" };
+    for (auto i = 0u; i < std::size(names); i++) {
+        if (name == names[i]) {
+            out = log_level(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+struct log_module_registry {
+    std::mutex lock;
+    std::vector<log_module*> modules;
+    std::vector<std::pair<std::string, log_level>> overrides;
+
+    static log_module_registry& get() {
+        static auto registry = log_module_registry {};
+        return registry;
+    }
+};
+
+log_module::log_module(const char* name): name(name) {
+    auto& r = log_module_registry::get();
+    auto l = std::lock_guard { r.lock };
+    r.modules.emplace_back(this);
+    for (auto& [n, level] : r.overrides) {
+        if (n == name) {
+            set_level(level);
+        }
+    }
+}
+
+log_module::~log_module() {
+    auto& r = log_module_registry::get();
+    auto l = std::lock_guard { r.lock };
+    std::erase(r.modules, this);
+}
+
+void set_log_level(std::string_view module, log_level level) {
+    auto& r = log_module_registry::get();
+    auto l = std::lock_guard { r.lock };
+    std::erase_if(r.overrides, [&](auto& o) { return o.first == module; });
+    r.overrides.emplace_back(std::string { module }, level);
+    for (auto* m : r.modules) {
+        if (m->name == module) {
+            m->set_level(level);
+        }
+    }
+}
+
+bool set_log_levels(std::string_view spec) {
+    auto global = std::optional<log_level> {};
+    auto modules = std::vector<std::pair<std::string_view, log_level>> {};
+    while (spec.size()) {
+        const auto comma = std::min(spec.find(','), spec.size());
+        const auto entry = spec.substr(0, comma);
+        spec.remove_prefix(std::min(comma + 1, spec.size()));
+        if (entry.empty()) {
+            continue;
+        }
+
+        auto level = log_level {};
+        if (const auto eq = entry.find('='); eq != std::string_view::npos) {
+            if (eq == 0 || !log_level_from_name(entry.substr(eq + 1), level)) {
+                return false;
+            }
+            modules.emplace_back(entry.substr(0, eq), level);
+        } else {
+            if (!log_level_from_name(entry, level)) {
+                return false;
+            }
+            global = level;
+        }
+    }
+
+    if (global) {
+        log_threshold().store(*global);
+    }
+    for (auto& [module, level] : modules) {
+        set_log_level(module, level);
+    }
+    return true;
+}
+
+void stderr_log_sink::write(std::string_view str) {
+    std::cerr.write(str.data(), str.size());
+#ifdef JLIB_LOG_VISUALSTUDIO
+    OutputDebugString(std::string { str }.c_str());
+#endif
+}
+
+using log_sink_list = std::vector<std::shared_ptr<log_sink>>;
+
+static std::atomic<std::shared_ptr<const log_sink_list>>& log_sinks() {
+    static auto sinks = std::atomic<std::shared_ptr<const log_sink_list>> {
+        std::make_shared<const log_sink_list>(log_sink_list { std::make_shared<stderr_log_sink>() })
+    };
+    return sinks;
+}
+
+// copy, modify, swap; retries if another thread changed the list in between
+template<typename F> static void update_log_sinks(F&& f) {
+    auto current = log_sinks().load();
+    while (true) {
+        auto next = std::make_shared<log_sink_list>(*current);
+        f(*next);
+        if (log_sinks().compare_exchange_weak(current, std::shared_ptr<const log_sink_list> { std::move(next) })) {
+            return;
+        }
+    }
+}
+
+void add_log_sink(std::shared_ptr<log_sink> sink) {
+    update_log_sinks([&](log_sink_list& sinks) { sinks.emplace_back(sink); });
+}
+
+void remove_log_sink(const std::shared_ptr<log_sink>& sink) {
+    update_log_sinks([&](log_sink_list& sinks) { std::erase(sinks, sink); });
+}
+
+void set_log_sinks(std::vector<std::shared_ptr<log_sink>> sinks) {
+    log_sinks().store(std::make_shared<const log_sink_list>(std::move(sinks)));
+}
+
+void init_log_sinks() {
+    log_sinks();
+}
+
+void flush_log_sinks() {
+    for (auto& sink : *log_sinks().load()) {
+        sink->flush();
+    }
+}
+
+void log_write(std::string_view str) {
+    if (auto* capture = thread_log_capture()) {
+        capture->append(str);
+        return;
+    }
+    for (auto& sink : *log_sinks().load()) {
+        sink->write(str);
+    }
+}
 #endif
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "log.h"
+#include "mpsc_ring.h"
+
+/*
+asynchronous logging
+
+log_async(...) takes the same arguments as log(), but only captures them into a
+lock-free ring buffer; a background thread formats records and writes them in batches
+
+    - arguments are captured by value, string-like arguments are copied
+        (so logging a temporary std::string or a stack buffer is safe)
+    - captures that don't fit in a record are formatted on the calling thread instead
+    - when the ring is full the overflow policy decides:
+        block: wait for the background thread to make room
+        drop:  discard the record
+        count: discard the record, and report how many were lost in the output
+    - flush() waits until everything logged before it has been written
+        the logger flushes on destruction, the global one at program exit
+
+usage:
+
+    log_async("request", id, "took", t.lap(), "us");
+    async_log().flush();
+*/
+
+enum class log_overflow {
+    block,
+    drop,
+    count,
+};
+
+struct async_log_options {
+    size_t capacity = 8192;
+    log_overflow overflow = log_overflow::block;
+};
+
+// quote{} | x for captured records, holds the value rather than a reference
+template<typename T, char Q> struct quotevalue {
+    static constexpr char quote_char = Q;
+    T t;
+};
+template<typename T, char Q> std::ostream& operator<<(std::ostream& o, const quotevalue<T, Q>& q) {
+    return o << Q << q.t << Q;
+}
+
+// how an argument is stored in a record
+template<typename T> struct log_capture {
+    using type = std::decay_t<T>;
+};
+template<typename T> using log_capture_t = typename log_capture<std::remove_cvref_t<T>>::type;
+template<> struct log_capture<const char*> { using type = std::string; };
+template<> struct log_capture<char*> { using type = std::string; };
+template<size_t N> struct log_capture<char[N]> { using type = std::string; };
+template<> struct log_capture<std::string_view> { using type = std::string; };
+template<typename T, char Q> struct log_capture<quotewrap<T, Q>> {
+    struct type: quotevalue<log_capture_t<T>, Q> {
+        type(const quotewrap<T, Q>& q): quotevalue<log_capture_t<T>, Q> { log_capture_t<T>(q.t) } {}
+    };
+};
+
+template<bool Space, bool Prefix> struct log_options {};
+
+// one queued log line: captured arguments plus how to format and destroy them
+struct log_record {
+    static constexpr size_t inline_size = 224;
+
+    template<bool Space, bool Prefix, typename... Args> log_record(log_options<Space, Prefix>, Args&&... args) {
+        using captured = std::tuple<log_capture_t<Args>...>;
+        if constexpr (sizeof(captured) <= inline_size && alignof(captured) <= alignof(std::max_align_t)) {
+            new (storage) captured(std::forward<Args>(args)...);
+            format = [](void* p, log_buffer& b) {
+                std::apply([&](auto&... a) { log_pf<Space, Prefix>(b, a...); }, *static_cast<captured*>(p));
+            };
+            destroy = [](void* p) { static_cast<captured*>(p)->~captured(); };
+        } else {
+            // too big to capture, format on the calling thread
+            auto b = log_buffer {};
+            log_format<Space, Prefix>(b, std::forward<Args>(args)...);
+            new (storage) std::string(std::move(b.data));
+            format = [](void* p, log_buffer& b) { b.data += *static_cast<std::string*>(p); };
+            destroy = [](void* p) { static_cast<std::string*>(p)->~basic_string(); };
+        }
+    }
+    log_record(const log_record&) = delete;
+    log_record& operator=(const log_record&) = delete;
+    ~log_record() {
+        destroy(storage);
+    }
+
+    void (*format)(void*, log_buffer&);
+    void (*destroy)(void*);
+    alignas(std::max_align_t) std::byte storage[inline_size];
+};
+
+// background consumer shared by the async loggers
+// producers construct Record in a lock-free ring, one thread drains it:
+// consume(Record&) for each record, then end_batch(newly dropped) after each batch
+template<typename Record> class log_queue {
+public:
+    using consume_fn = std::function<void(Record&)>;
+    using end_batch_fn = std::function<void(uint64_t)>;
+
+    log_queue(async_log_options options, consume_fn consume, end_batch_fn end_batch):
+        options(options),
+        ring(options.capacity),
+        consume(std::move(consume)),
+        end_batch(std::move(end_batch)) {
+        // end_batch writes to the sinks, including from the destructor's flush at exit
+        init_log_sinks();
+        thread = std::thread([this] { run(); });
+    }
+    log_queue(const log_queue&) = delete;
+    log_queue& operator=(const log_queue&) = delete;
+    ~log_queue() {
+        flush();
+        stopping.store(true);
+        wake();
+        thread.join();
+    }
+
+    template<typename... Args> void push(Args&&... args) {
+        while (!ring.try_emplace(std::forward<Args>(args)...)) {
+            if (options.overflow != log_overflow::block) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            wake();
+            std::this_thread::yield();
+        }
+        // pairs with the fence in run(): either we see it sleeping, or it sees our record
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    // block until every record pushed before this call has been consumed
+    // waits for slots rather than completed pushes: records are consumed in slot order, and a
+    // push can complete while an earlier slot is still being filled by another producer
+    void flush() {
+        const auto target = uint64_t(ring.claimed());
+        auto w = consumed.load(std::memory_order_acquire);
+        while (w < target) {
+            wake();
+            consumed.wait(w, std::memory_order_acquire);
+            w = consumed.load(std::memory_order_acquire);
+        }
+    }
+
+    uint64_t dropped() const {
+        return dropped_count.load(std::memory_order_relaxed);
+    }
+    log_overflow overflow() const {
+        return options.overflow;
+    }
+
+private:
+    async_log_options options;
+    mpsc_ring<Record> ring;
+    consume_fn consume;
+    end_batch_fn end_batch;
+    std::atomic<uint64_t> consumed = 0; // records popped, in slot order
+    std::atomic<uint64_t> dropped_count = 0;
+    uint64_t reported_dropped = 0;
+    std::atomic<bool> sleeping = false;
+    std::atomic<bool> stopping = false;
+    std::thread thread;
+
+    void wake() {
+        sleeping.store(false);
+        sleeping.notify_one();
+    }
+
+    void run() {
+        constexpr auto max_batch = 256;
+        while (true) {
+            auto n = 0;
+            while (n < max_batch && ring.try_pop(consume)) {
+                n++;
+            }
+
+            const auto dropped = dropped_count.load(std::memory_order_relaxed);
+            if (n || dropped != reported_dropped) {
+                end_batch(dropped - reported_dropped);
+                reported_dropped = dropped;
+            }
+            if (n) {
+                consumed.fetch_add(n, std::memory_order_release);
+                consumed.notify_all();
+                continue;
+            }
+
+            if (stopping.load() && ring.empty()) {
+                return;
+            }
+
+            // park until a producer (or flush/shutdown) wakes us
+            sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!ring.empty() || stopping.load()) {
+                sleeping.store(false);
+                continue;
+            }
+            sleeping.wait(true);
+        }
+    }
+};
+
+class async_logger {
+public:
+    explicit async_logger(async_log_options options = {});
+    async_logger(const async_logger&) = delete;
+    async_logger& operator=(const async_logger&) = delete;
+
+    template<bool Space = true, bool Prefix = true, typename... Args> void log(Args&&... args) {
+        queue.push(log_options<Space, Prefix> {}, std::forward<Args>(args)...);
+    }
+
+    // block until every record logged before this call has been written
+    void flush() {
+        queue.flush();
+    }
+
+    // records discarded because the ring was full
+    uint64_t dropped() const {
+        return queue.dropped();
+    }
+
+private:
+    // only touched by the background thread
+    log_buffer batch;
+
+    log_queue<log_record> queue; // last: joins the thread before the buffers go away
+};
+
+// global async logger, started on first use and flushed at exit
+async_logger& async_log();
+
+template<bool Space = true, bool Prefix = true, typename... Args> void log_async(Args&&... args) {
+    async_log().log<Space, Prefix>(std::forward<Args>(args)...);
+}
+
+#ifdef JLIB_IMPLEMENTATION
+async_logger::async_logger(async_log_options options):
+    queue(
+        options,
+        [this](log_record& r) {
+            // log_pad counts from the start of this record, not the batch
+            batch.line_start = batch.data.size();
+            batch.reset_format();
+            r.format(r.storage, batch);
+        },
+        [this, overflow = options.overflow](uint64_t dropped) {
+            if (dropped && overflow == log_overflow::count) {
+                log_pf<true, true>(batch, "dropped", dropped, "records");
+            }
+            if (batch.data.size()) {
+                log_write(batch.data);
+                batch.begin();
+            }
+        }
+    ) {}
+
+async_logger& async_log() {
+    static auto logger = async_logger {};
+    return logger;
+}
+#endif
@@ -0,0 +1,570 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "jenum.h"
+#include "log.h"
+#include "log_async.h"
+
+/*
+binary (deferred) logging
+
+LOG_BINARY("format {} with {} placeholders", args...)
+the calling thread doesn't format anything: it copies the raw argument values into a
+compact record tagged with the call site's id, and the background thread either
+    - formats it and writes it to the log output (default), or
+    - appends the raw record to a file, to be formatted offline by jlib_log_decode
+
+    - supported arguments: bool, char, integers, floating point, strings, enums
+        (enums declared with the jenum macros are decoded to their enumerator names)
+    - the format string, file and line are stored once per call site, not per record
+    - strings longer than the record has room for are truncated
+    - arguments without a matching {} are appended at the end
+
+usage:
+
+    LOG_BINARY("request {} took {}us", id, t.lap());
+
+    // offline: log raw records to a file, decode later with jlib_log_decode
+    // (before the first LOG_BINARY, the global logger's options are fixed once it starts)
+    configure_binary_log({ .path = "app.jlb" });
+*/
+
+enum class binary_arg : uint8_t {
+    boolean,
+    character,
+    i64,
+    u64,
+    f64,
+    string,
+    enumeration,
+};
+
+// static per call site, see LOG_BINARY
+struct binary_log_site {
+    const char* format;
+    const char* file;
+    int line;
+    std::atomic<uint32_t> id = 0; // assigned on first use
+};
+
+// everything needed to format a site's records
+struct binary_site_info {
+    std::string format;
+    std::string file;
+    int line = 0;
+    std::vector<binary_arg> args;
+    std::vector<std::string> enum_tables; // one per arg, "name=value;..." for jenum args
+};
+
+// registry of call sites, id = index + 1
+struct binary_log_sites {
+    std::mutex lock;
+    std::vector<binary_site_info> sites;
+
+    uint32_t add(binary_site_info info) {
+        auto l = std::lock_guard { lock };
+        sites.emplace_back(std::move(info));
+        return sites.size();
+    }
+    binary_site_info get(uint32_t id) {
+        auto l = std::lock_guard { lock };
+        return sites.at(id - 1);
+    }
+};
+binary_log_sites& binary_log_site_registry();
+
+// how a C++ type is logged
+template<typename T> constexpr binary_arg binary_arg_kind() {
+    using U = std::remove_cvref_t<std::decay_t<T>>;
+    if constexpr (std::is_same_v<U, bool>) {
+        return binary_arg::boolean;
+    } else if constexpr (std::is_same_v<U, char>) {
+        return binary_arg::character;
+    } else if constexpr (std::is_enum_v<U>) {
+        return binary_arg::enumeration;
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        return binary_arg::i64;
+    } else if constexpr (std::is_integral_v<U>) {
+        return binary_arg::u64;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return binary_arg::f64;
+    } else {
+        static_assert(std::is_convertible_v<const T&, std::string_view>, "LOG_BINARY supports bool, char, integers, floats, strings and enums");
+        return binary_arg::string;
+    }
+}
+
+// worst case payload bytes for an argument, excluding string contents
+constexpr size_t binary_arg_size(binary_arg kind) {
+    switch (kind) {
+        case binary_arg::boolean:
+        case binary_arg::character: return 1;
+        case binary_arg::string: return 2;
+        default: return 8;
+    }
+}
+
+// one queued record
+struct binary_log_record {
+    static constexpr size_t payload_size = 240;
+
+    uint32_t site = 0;
+    uint32_t size = 0;
+    std::byte payload[payload_size];
+
+    template<typename... Args> binary_log_record(uint32_t site, const Args&... args): site(site) {
+        reserved = (binary_arg_size(binary_arg_kind<Args>()) + ... + 0);
+        (write_arg(args), ...);
+    }
+    binary_log_record(const binary_log_record&) = delete;
+    binary_log_record& operator=(const binary_log_record&) = delete;
+
+private:
+    size_t reserved = 0; // bytes still needed by the remaining arguments, excluding string contents
+
+    void write_raw(const void* data, size_t n) {
+        std::memcpy(payload + size, data, n);
+        size += n;
+    }
+    template<typename T> void write_value(T t) {
+        write_raw(&t, sizeof(T));
+    }
+    template<typename Arg> void write_arg(const Arg& arg);
+};
+
+template<typename Arg> void binary_log_record::write_arg(const Arg& arg) {
+    constexpr auto kind = binary_arg_kind<Arg>();
+    reserved -= binary_arg_size(kind);
+    if constexpr (kind == binary_arg::string) {
+        auto str = std::string_view { arg };
+        const auto room = payload_size - size - binary_arg_size(kind) - reserved;
+        const auto n = uint16_t(std::min({ str.size(), room, size_t { UINT16_MAX } }));
+        write_value(n);
+        write_raw(str.data(), n);
+    } else if constexpr (kind == binary_arg::boolean || kind == binary_arg::character) {
+        write_value(uint8_t(arg));
+    } else if constexpr (kind == binary_arg::f64) {
+        write_value(double(arg));
+    } else if constexpr (kind == binary_arg::u64) {
+        write_value(uint64_t(arg));
+    } else {
+        write_value(int64_t(arg));
+    }
+}
+
+// "name=value;..." for enums declared with the jenum macros, empty otherwise
+template<typename E> std::string binary_enum_table() {
+    if constexpr (requires { jenum_s<E> {}.count(); }) {
+        const auto helper = jenum_s<E> {};
+        const auto decl = jenum_string<E>();
+        auto table = std::string {};
+        auto index = 0;
+        auto depth = 0;
+        auto start = size_t { 0 };
+        for (auto i = size_t { 0 }; i <= decl.size(); i++) {
+            const auto c = i < decl.size() ? decl[i] : ',';
+            depth += (c == '(' || c == '<' || c == '{') - (c == ')' || c == '>' || c == '}');
+            if (c != ',' || depth != 0) {
+                continue;
+            }
+            auto name = decl.substr(start, decl.find('=', start) < i ? decl.find('=', start) - start : i - start);
+            while (name.size() && name.front() == ' ') {
+                name.remove_prefix(1);
+            }
+            while (name.size() && name.back() == ' ') {
+                name.remove_suffix(1);
+            }
+            table += std::string { name } + '=' + std::to_string(int64_t(helper[index++])) + ';';
+            start = i + 1;
+        }
+        return table;
+    } else {
+        return {};
+    }
+}
+
+template<typename... Args> binary_site_info binary_site_info_for(const binary_log_site& site) {
+    auto info = binary_site_info {};
+    info.format = site.format;
+    info.file = site.file;
+    info.line = site.line;
+    info.args = { binary_arg_kind<Args>()... };
+    [[maybe_unused]] auto add_table = [&]<typename T>() {
+        using U = std::remove_cvref_t<std::decay_t<T>>;
+        if constexpr (std::is_enum_v<U>) {
+            info.enum_tables.emplace_back(binary_enum_table<U>());
+        } else {
+            info.enum_tables.emplace_back();
+        }
+    };
+    (add_table.template operator()<Args>(), ...);
+    return info;
+}
+
+// format a record's payload according to its site
+// returns false if the payload doesn't match the site's argument list
+bool format_binary_record(const binary_site_info& site, const std::byte* payload, size_t size, std::string& out);
+
+// decode a raw binary log file written by binary_logger, appending text to out
+// returns false if the data is malformed (out holds everything decoded up to that point)
+bool decode_binary_log(std::istream& in, std::string& out);
+
+struct binary_log_options {
+    size_t capacity = 8192;
+    log_overflow overflow = log_overflow::block;
+    std::filesystem::path path; // empty: format in the background, otherwise write raw records here
+};
+
+class binary_logger {
+public:
+    explicit binary_logger(binary_log_options options = {});
+    binary_logger(const binary_logger&) = delete;
+    binary_logger& operator=(const binary_logger&) = delete;
+
+    template<typename... Args> void log(binary_log_site& site, const Args&... args) {
+        static_assert(
+            (binary_arg_size(binary_arg_kind<Args>()) + ... + 0) <= binary_log_record::payload_size,
+            "too many arguments for one binary log record"
+        );
+        auto id = site.id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = register_site<Args...>(site);
+        }
+        queue.push(id, args...);
+    }
+
+    void flush() {
+        queue.flush();
+    }
+    uint64_t dropped() const {
+        return queue.dropped();
+    }
+
+private:
+    template<typename... Args> static uint32_t register_site(binary_log_site& site) {
+        static auto lock = std::mutex {};
+        auto l = std::lock_guard { lock };
+        if (auto id = site.id.load(std::memory_order_acquire)) {
+            return id; // another thread got here first
+        }
+        const auto id = binary_log_site_registry().add(binary_site_info_for<Args...>(site));
+        site.id.store(id, std::memory_order_release);
+        return id;
+    }
+
+    void consume(binary_log_record& r);
+    void end_batch(uint64_t dropped);
+
+    // only touched by the background thread
+    binary_log_options options;
+    std::ofstream file;
+    std::vector<uint32_t> file_ids; // registry id - 1 -> id in the file, 0 until its 'S' record is written
+    uint32_t file_sites = 0;
+    std::vector<binary_site_info> site_cache;
+    std::string batch;
+
+    log_queue<binary_log_record> queue; // last: joins the thread before the rest goes away
+};
+
+// options for the global binary logger
+// throws std::logic_error if it has already started, so call it before anything logs
+void configure_binary_log(binary_log_options options);
+
+// global binary logger, started on first use with the configured options
+binary_logger& binary_log();
+
+#define LOG_BINARY(format, ...)                                                      \
+    do {                                                                             \
+        static auto _jlib_binary_site = binary_log_site { format, __FILE__, __LINE__ }; \
+        binary_log().log(_jlib_binary_site __VA_OPT__(, ) __VA_ARGS__);              \
+    } while (0)
+
+#ifdef JLIB_IMPLEMENTATION
+
+#include <charconv>
+
+binary_log_sites& binary_log_site_registry() {
+    static auto registry = binary_log_sites {};
+    return registry;
+}
+
+bool format_binary_record(const binary_site_info& site, const std::byte* payload, size_t size, std::string& out) {
+    auto offset = size_t { 0 };
+    auto read = [&](void* dst, size_t n) {
+        if (offset + n > size) {
+            return false;
+        }
+        std::memcpy(dst, payload + offset, n);
+        offset += n;
+        return true;
+    };
+
+    auto format = std::string_view { site.format };
+    auto append_arg = [&](size_t i) {
+        char buf[32];
+        switch (site.args[i]) {
+            case binary_arg::boolean:
+            case binary_arg::character: {
+                auto v = uint8_t {};
+                if (!read(&v, 1)) {
+                    return false;
+                }
+                if (site.args[i] == binary_arg::boolean) {
+                    out += v ? "1" : "0";
+                } else {
+                    out += char(v);
+                }
+                return true;
+            }
+            case binary_arg::i64:
+            case binary_arg::enumeration: {
+                auto v = int64_t {};
+                if (!read(&v, 8)) {
+                    return false;
+                }
+                if (site.args[i] == binary_arg::enumeration && site.enum_tables[i].size()) {
+                    // find "name=value;" in the table
+                    auto table = std::string_view { site.enum_tables[i] };
+                    const auto key = "=" + std::to_string(v) + ";";
+                    if (auto at = table.find(key); at != std::string_view::npos) {
+                        const auto begin = table.rfind(';', at) == std::string_view::npos ? 0 : table.rfind(';', at) + 1;
+                        out += table.substr(begin, at - begin);
+                        return true;
+                    }
+                }
+                out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                return true;
+            }
+            case binary_arg::u64: {
+                auto v = uint64_t {};
+                if (!read(&v, 8)) {
+                    return false;
+                }
+                out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                return true;
+            }
+            case binary_arg::f64: {
+                auto v = double {};
+                if (!read(&v, 8)) {
+                    return false;
+                }
+                out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+                return true;
+            }
+            case binary_arg::string: {
+                auto n = uint16_t {};
+                if (!read(&n, 2) || offset + n > size) {
+                    return false;
+                }
+                out.append(reinterpret_cast<const char*>(payload + offset), n);
+                offset += n;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    out += "LOG: ";
+    auto arg = size_t { 0 };
+    while (format.size()) {
+        const auto at = format.find("{}");
+        out += format.substr(0, at);
+        if (at == std::string_view::npos) {
+            break;
+        }
+        format.remove_prefix(at + 2);
+        if (arg < site.args.size()) {
+            if (!append_arg(arg++)) {
+                return false;
+            }
+        } else {
+            out += "{}";
+        }
+    }
+    for (; arg < site.args.size(); arg++) {
+        out += ' ';
+        if (!append_arg(arg)) {
+            return false;
+        }
+    }
+    out += '\n';
+    return offset == size;
+}
+
+/*
+raw file layout, all integers little endian (native)
+    "JLB1"
+    then any number of:
+        'S' site:   u32 id (1, 2, 3... in order of definition), u16 format length, format, u16 file length, file, i32 line,
+                    u8 arg count, arg kinds, then a u16-length enum table per arg
+        'R' record: u32 site id, u16 payload size, payload
+*/
+static constexpr char binary_log_magic[4] = { 'J', 'L', 'B', '1' };
+
+static void write_binary_string(std::ostream& o, std::string_view s) {
+    const auto n = uint16_t(std::min(s.size(), size_t { UINT16_MAX }));
+    o.write(reinterpret_cast<const char*>(&n), 2);
+    o.write(s.data(), n);
+}
+static bool read_binary_string(std::istream& in, std::string& s) {
+    auto n = uint16_t {};
+    if (!in.read(reinterpret_cast<char*>(&n), 2)) {
+        return false;
+    }
+    s.resize(n);
+    return bool(in.read(s.data(), n));
+}
+
+bool decode_binary_log(std::istream& in, std::string& out) {
+    char magic[4];
+    if (!in.read(magic, 4) || std::memcmp(magic, binary_log_magic, 4) != 0) {
+        return false;
+    }
+
+    auto sites = std::vector<binary_site_info> {};
+    auto payload = std::vector<std::byte> {};
+    auto tag = char {};
+    while (in.get(tag)) {
+        auto id = uint32_t {};
+        if (!in.read(reinterpret_cast<char*>(&id), 4) || id == 0) {
+            return false;
+        }
+        if (tag == 'S') {
+            // site ids count up from 1 in the order they're defined, anything else is a corrupt file
+            if (id != sites.size() + 1) {
+                return false;
+            }
+            auto info = binary_site_info {};
+            auto nargs = uint8_t {};
+            if (!read_binary_string(in, info.format) || !read_binary_string(in, info.file)
+                || !in.read(reinterpret_cast<char*>(&info.line), 4) || !in.read(reinterpret_cast<char*>(&nargs), 1)) {
+                return false;
+            }
+            info.args.resize(nargs);
+            info.enum_tables.resize(nargs);
+            if (!in.read(reinterpret_cast<char*>(info.args.data()), nargs)) {
+                return false;
+            }
+            for (auto& table : info.enum_tables) {
+                if (!read_binary_string(in, table)) {
+                    return false;
+                }
+            }
+            sites.emplace_back(std::move(info));
+        } else if (tag == 'R') {
+            auto size = uint16_t {};
+            if (!in.read(reinterpret_cast<char*>(&size), 2) || id > sites.size()) {
+                return false;
+            }
+            payload.resize(size);
+            if (!in.read(reinterpret_cast<char*>(payload.data()), size)
+                || !format_binary_record(sites[id - 1], payload.data(), size, out)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+binary_logger::binary_logger(binary_log_options options):
+    options(options),
+    queue(
+        { options.capacity, options.overflow },
+        [this](binary_log_record& r) { consume(r); },
+        [this](uint64_t dropped) { end_batch(dropped); }
+    ) {
+    // the background thread reads the registry until this logger is destroyed, so it has to be
+    // constructed first: statics are destroyed in reverse order of construction
+    binary_log_site_registry();
+}
+
+void binary_logger::consume(binary_log_record& r) {
+    if (site_cache.size() < r.site) {
+        site_cache.resize(r.site);
+        file_ids.resize(r.site, 0);
+    }
+    auto& site = site_cache[r.site - 1];
+    if (site.format.empty()) {
+        site = binary_log_site_registry().get(r.site);
+    }
+
+    if (options.path.empty()) {
+        format_binary_record(site, r.payload, r.size, batch);
+        return;
+    }
+
+    if (!file.is_open()) {
+        file.open(options.path, std::ios::binary | std::ios::trunc);
+        file.write(binary_log_magic, 4);
+    }
+    // the registry is process wide and most sites never log to this file, so files number their own sites
+    auto& file_id = file_ids[r.site - 1];
+    if (!file_id) {
+        file_id = ++file_sites;
+        file.put('S');
+        file.write(reinterpret_cast<const char*>(&file_id), 4);
+        write_binary_string(file, site.format);
+        write_binary_string(file, site.file);
+        file.write(reinterpret_cast<const char*>(&site.line), 4);
+        file.put(char(site.args.size()));
+        file.write(reinterpret_cast<const char*>(site.args.data()), site.args.size());
+        for (auto& table : site.enum_tables) {
+            write_binary_string(file, table);
+        }
+    }
+    const auto size = uint16_t(r.size);
+    file.put('R');
+    file.write(reinterpret_cast<const char*>(&file_id), 4);
+    file.write(reinterpret_cast<const char*>(&size), 2);
+    file.write(reinterpret_cast<const char*>(r.payload), size);
+}
+
+void binary_logger::end_batch(uint64_t dropped) {
+    if (dropped && options.overflow == log_overflow::count) {
+        batch += "LOG: dropped " + std::to_string(dropped) + " binary records\n";
+    }
+    if (batch.size()) {
+        log_write(batch);
+        batch.clear();
+    }
+    if (file.is_open()) {
+        file.flush();
+    }
+}
+
+static binary_log_options& binary_log_config() {
+    static auto options = binary_log_options {};
+    return options;
+}
+static auto binary_log_started = std::atomic<bool> { false };
+
+void configure_binary_log(binary_log_options options) {
+    if (binary_log_started.load()) {
+        throw std::logic_error("configure_binary_log: the binary logger has already started");
+    }
+    binary_log_config() = std::move(options);
+}
+
+binary_logger& binary_log() {
+    static auto logger = [] {
+        binary_log_started.store(true);
+        return binary_logger { binary_log_config() };
+    }();
+    return logger;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "log.h"
+
+/*
+file_log_sink
+
+buffered log file with rotation
+    - writes collect in a userspace buffer and go out in one write when it fills,
+        when flush() is called, or on the first write after flush_interval
+    - rotation by size and/or age: path -> path.1 -> path.2 ... up to max_files
+    - optional fdatasync, on every flush or only when rotating
+    - thread safe, one mutex per sink
+
+usage:
+
+    add_log_sink(std::make_shared<file_log_sink>("app.log", file_log_options { .max_size = 64 << 20 }));
+    set_log_sinks({ std::make_shared<file_log_sink>("app.log") }); // file only, no stderr
+*/
+
+enum class log_sync {
+    none, // leave it to the OS
+    on_flush, // fdatasync after every flush
+    on_rotate, // fdatasync before closing a rotated file
+};
+
+struct file_log_options {
+    size_t buffer_size = 1 << 20;
+    size_t max_size = 0; // rotate once the file would grow past this, 0 = never
+    std::chrono::seconds max_age { 0 }; // rotate files older than this, 0 = never
+    size_t max_files = 5; // rotated files to keep
+    std::chrono::milliseconds flush_interval { 1000 }; // 0 = only flush when the buffer is full
+    log_sync sync = log_sync::none;
+};
+
+class file_log_sink final : public log_sink {
+public:
+    explicit file_log_sink(std::filesystem::path path, file_log_options options = {});
+    file_log_sink(const file_log_sink&) = delete;
+    file_log_sink& operator=(const file_log_sink&) = delete;
+    ~file_log_sink() override;
+
+    void write(std::string_view str) override;
+    void flush() override;
+
+    // false if the file couldn't be opened (writes are dropped)
+    bool is_open() const {
+        return file != nullptr;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    std::filesystem::path path;
+    file_log_options options;
+    std::mutex lock;
+    std::FILE* file = nullptr;
+    std::string buffer;
+    size_t file_size = 0; // bytes already in the file, excluding the buffer
+    clock::time_point opened;
+    clock::time_point last_flush;
+
+    void open();
+    void close(bool sync);
+    void rotate();
+    void flush_buffer(bool sync);
+};
+
+#ifdef JLIB_IMPLEMENTATION
+
+#if (defined __unix__ || defined __APPLE__)
+#include <unistd.h>
+#endif
+
+static void log_file_sync(std::FILE* file) {
+#if (defined __APPLE__)
+    fsync(fileno(file));
+#elif (defined __unix__)
+    fdatasync(fileno(file));
+#else
+    (void)file;
+#endif
+}
+
+file_log_sink::file_log_sink(std::filesystem::path path, file_log_options options):
+    path(std::move(path)),
+    options(options) {
+    buffer.reserve(options.buffer_size);
+    open();
+}
+
+file_log_sink::~file_log_sink() {
+    auto l = std::lock_guard { lock };
+    close(options.sync != log_sync::none);
+}
+
+void file_log_sink::open() {
+    file = std::fopen(path.string().c_str(), "ab");
+    if (file) {
+        // we do our own buffering
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        auto ec = std::error_code {};
+        const auto size = std::filesystem::file_size(path, ec);
+        file_size = ec ? 0 : size;
+    }
+    opened = last_flush = clock::now();
+}
+
+void file_log_sink::close(bool sync) {
+    flush_buffer(sync);
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void file_log_sink::rotate() {
+    close(options.sync != log_sync::none);
+
+    auto ec = std::error_code {};
+    if (options.max_files == 0) {
+        std::filesystem::remove(path, ec);
+    } else {
+        auto numbered = [&](size_t i) { return std::filesystem::path { path.string() + '.' + std::to_string(i) }; };
+        std::filesystem::remove(numbered(options.max_files), ec);
+        for (auto i = options.max_files; i > 1; i--) {
+            std::filesystem::rename(numbered(i - 1), numbered(i), ec);
+        }
+        std::filesystem::rename(path, numbered(1), ec);
+    }
+    open();
+}
+
+void file_log_sink::flush_buffer(bool sync) {
+    if (file && buffer.size()) {
+        file_size += std::fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+    buffer.clear();
+    if (file && sync) {
+        log_file_sync(file);
+    }
+    last_flush = clock::now();
+}
+
+void file_log_sink::write(std::string_view str) {
+    auto l = std::lock_guard { lock };
+    const auto now = clock::now();
+    const auto too_big = options.max_size && file_size + buffer.size() + str.size() > options.max_size
+        && file_size + buffer.size() > 0;
+    const auto too_old = options.max_age.count() && now - opened >= options.max_age;
+    if (too_big || too_old) {
+        rotate();
+    }
+    if (!file) {
+        return;
+    }
+
+    buffer += str;
+    if (buffer.size() >= options.buffer_size || (options.flush_interval.count() && now - last_flush >= options.flush_interval)) {
+        flush_buffer(options.sync == log_sync::on_flush);
+    }
+}
+
+void file_log_sink::flush() {
+    auto l = std::lock_guard { lock };
+    flush_buffer(options.sync == log_sync::on_flush);
+}
+
+#endif
@@ -0,0 +1,197 @@
+// mapped_file.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+
+/*
+mapped_file
+
+read-only view of a whole file, memory mapped where the platform supports it
+
+    auto file = mapped_file("big.log");
+    if (file.is_open()) {
+        process(file.text()); // no copy, pages are read in on first touch
+    }
+
+    - move only, unmaps on destruction; views into text() die with it
+    - empty files open fine and have size() == 0
+    - bytes() is the same view for binary data
+    - advise() passes access pattern hints to the kernel (madvise), eg. sequential to read ahead
+        aggressively and drop pages behind, or willneed to start reading a range in the background
+    - without mmap (not unix) the file is read into an owned buffer instead, same interface,
+        and advise() does nothing
+*/
+
+enum class map_advice { normal, sequential, random, willneed };
+
+class mapped_file {
+public:
+    mapped_file() = default;
+    explicit mapped_file(const std::filesystem::path& path) {
+        open(path);
+    }
+    mapped_file(mapped_file&& other) noexcept {
+        *this = std::move(other);
+    }
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file() {
+        close();
+    }
+
+    // returns false if the file couldn't be opened or mapped
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    bool is_open() const {
+        return opened;
+    }
+    const char* data() const {
+        return begin;
+    }
+    size_t size() const {
+        return length;
+    }
+    bool empty() const {
+        return length == 0;
+    }
+    std::string_view text() const {
+        return { begin, length };
+    }
+    std::span<const uint8_t> bytes() const {
+        return { reinterpret_cast<const uint8_t*>(begin), length };
+    }
+
+    // hint how [offset, offset + length) will be accessed, the whole file by default
+    // returns false if the kernel rejected the hint
+    bool advise(map_advice advice, size_t offset = 0, size_t length = SIZE_MAX) const;
+
+private:
+    const char* begin = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    std::string fallback; // owns the data when there is no mmap
+};
+
+#ifdef JLIB_IMPLEMENTATION
+
+#include <algorithm>
+
+#if (defined __unix__ || defined __APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+    if (this != &other) {
+        close();
+        fallback = std::move(other.fallback);
+        begin = fallback.empty() ? other.begin : fallback.data();
+        length = other.length;
+        opened = other.opened;
+        other.begin = nullptr;
+        other.length = 0;
+        other.opened = false;
+    }
+    return *this;
+}
+
+#if (defined __unix__ || defined __APPLE__)
+
+bool mapped_file::open(const std::filesystem::path& path) {
+    close();
+    const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    length = size_t(st.st_size);
+    if (length > 0) {
+        auto* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        begin = static_cast<const char*>(p);
+    }
+    // the mapping keeps the file alive
+    ::close(fd);
+    opened = true;
+    return true;
+}
+
+bool mapped_file::advise(map_advice advice, size_t offset, size_t len) const {
+    if (!begin || offset >= length) {
+        return opened;
+    }
+    static constexpr int advices[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED };
+    // madvise wants a page aligned start
+    static const auto page = size_t(sysconf(_SC_PAGESIZE));
+    const auto start = offset / page * page;
+    const auto end = offset + std::min(len, length - offset);
+    return madvise(const_cast<char*>(begin) + start, end - start, advices[int(advice)]) == 0;
+}
+
+void mapped_file::close() {
+    if (begin) {
+        munmap(const_cast<char*>(begin), length);
+    }
+    begin = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+bool mapped_file::open(const std::filesystem::path& path) {
+    close();
+    auto file = std::ifstream(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    auto ec = std::error_code {};
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    fallback.resize(size);
+    if (!file.read(fallback.data(), std::streamsize(size))) {
+        fallback.clear();
+        return false;
+    }
+    begin = fallback.data();
+    length = size;
+    opened = true;
+    return true;
+}
+
+bool mapped_file::advise(map_advice, size_t, size_t) const {
+    return opened;
+}
+
+void mapped_file::close() {
+    fallback.clear();
+    fallback.shrink_to_fit();
+    begin = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+// mpsc_ring.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+/*
+mpsc_ring<T>
+
+bounded lock-free queue, many producers, one consumer
+    - per-slot sequence numbers (Vyukov's bounded queue), producers claim slots with one CAS
+    - elements are constructed directly in their slot and consumed in place, no extra moves
+    - capacity is rounded up to a power of two
+    - try_emplace fails instead of blocking when the ring is full
+*/
+
+template<typename T> class mpsc_ring {
+public:
+    explicit mpsc_ring(size_t capacity):
+        capacity(std::bit_ceil(std::max(capacity, size_t { 2 }))),
+        mask(this->capacity - 1),
+        slots(std::make_unique<slot[]>(this->capacity)) {
+        for (auto i = 0u; i < this->capacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    mpsc_ring(const mpsc_ring&) = delete;
+    mpsc_ring& operator=(const mpsc_ring&) = delete;
+    ~mpsc_ring() {
+        while (try_pop([](T&) {}))
+            ;
+    }
+
+    // any thread; constructs T(args...) in the next free slot
+    // returns false if the ring is full
+    template<typename... Args> bool try_emplace(Args&&... args) {
+        auto pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            auto& s = slots[pos & mask];
+            const auto seq = s.sequence.load(std::memory_order_acquire);
+            const auto diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (s.storage) T(std::forward<Args>(args)...);
+                    s.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer only; calls f(T&) on the oldest element, then destroys it
+    // returns false if the ring is empty
+    template<typename F> bool try_pop(F&& f) {
+        const auto pos = dequeue_pos.load(std::memory_order_relaxed);
+        auto& s = slots[pos & mask];
+        const auto seq = s.sequence.load(std::memory_order_acquire);
+        if (intptr_t(seq) - intptr_t(pos + 1) < 0) {
+            return false;
+        }
+        auto* item = std::launder(reinterpret_cast<T*>(s.storage));
+        f(*item);
+        item->~T();
+        s.sequence.store(pos + capacity, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate when producers are active
+    bool empty() const {
+        return size() == 0;
+    }
+    size_t size() const {
+        const auto pos = enqueue_pos.load(std::memory_order_acquire);
+        const auto deq = dequeue_pos.load(std::memory_order_acquire);
+        return pos > deq ? pos - deq : 0;
+    }
+    // slots claimed so far, in pop order: once the consumer has popped this many,
+    // every element whose try_emplace returned before this call is gone
+    size_t claimed() const {
+        return enqueue_pos.load(std::memory_order_acquire);
+    }
+    size_t get_capacity() const {
+        return capacity;
+    }
+
+private:
+    struct slot {
+        std::atomic<size_t> sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    size_t capacity;
+    size_t mask;
+    std::unique_ptr<slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueue_pos = 0;
+    alignas(64) std::atomic<size_t> dequeue_pos = 0; // only written by the consumer
+};
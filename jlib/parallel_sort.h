@@ -0,0 +1,93 @@
+// parallel_sort.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <vector>
+
+#include "task_engine.h"
+
+// merge the sorted runs [first, middle) and [middle, last) in place, on the engine
+// compare is called concurrently from the engine's workers
+// splits the longer run at its midpoint, finds the matching split in the other run and rotates the two
+// inner pieces past each other, which leaves two smaller merges that don't overlap and can run in parallel
+// pieces under parallel_merge_leaf elements go to std::inplace_merge, so its temporary buffer stays
+// under parallel_merge_leaf / 2 elements per worker instead of growing to half the range
+constexpr auto parallel_merge_leaf = size_t { 1 << 13 };
+
+template<std::random_access_iterator It, typename Compare>
+void parallel_merge(task_engine& engine, It first, It middle, It last, Compare& compare) {
+    const auto n1 = size_t(middle - first);
+    const auto n2 = size_t(last - middle);
+    if (n1 == 0 || n2 == 0) {
+        return;
+    }
+    if (n1 + n2 <= parallel_merge_leaf) {
+        std::inplace_merge(first, middle, last, compare);
+        return;
+    }
+
+    auto cut1 = first;
+    auto cut2 = middle;
+    if (n1 >= n2) {
+        cut1 = first + n1 / 2;
+        cut2 = std::lower_bound(middle, last, *cut1, compare);
+    } else {
+        cut2 = middle + n2 / 2;
+        cut1 = std::upper_bound(first, middle, *cut2, compare);
+    }
+    const auto new_middle = std::rotate(cut1, middle, cut2);
+
+    auto group = wait_group {};
+    engine.submit(group, [&engine, &compare, first, cut1, new_middle] { parallel_merge(engine, first, cut1, new_middle, compare); });
+    parallel_merge(engine, new_middle, cut2, last, compare);
+    engine.wait(group);
+}
+
+// parallel sort
+// compare is shared by every worker, so it must be safe to call from several threads at once
+// splits the range into one chunk per worker, sorts the chunks concurrently on the engine,
+// then merges neighbouring chunks pairwise with parallel_merge until one run remains
+// no allocation proportional to the input: extra memory is the bounded merge buffers above
+// small inputs are sorted on the calling thread
+template<std::random_access_iterator It, typename Compare = std::greater<>>
+void parallel_sort(It first, It last, Compare compare = {}, task_engine& engine = default_task_engine()) {
+    constexpr auto min_chunk = size_t { 1 << 15 };
+    const auto count = size_t(last - first);
+    const auto num_chunks = std::min(engine.size(), std::max(count / min_chunk, size_t { 1 }));
+    if (num_chunks == 1) {
+        std::sort(first, last, compare);
+        return;
+    }
+
+    // chunk boundaries
+    auto bounds = std::vector<It> {};
+    for (auto i = 0u; i <= num_chunks; i++) {
+        bounds.emplace_back(first + (count * i) / num_chunks);
+    }
+    parallel_for(engine, 0, num_chunks, [&](size_t i) { std::sort(bounds[i], bounds[i + 1], compare); }, 1);
+
+    while (bounds.size() > 2) {
+        const auto pairs = (bounds.size() - 1) / 2;
+        parallel_for(engine, 0, pairs, [&](size_t p) {
+            parallel_merge(engine, bounds[2 * p], bounds[2 * p + 1], bounds[2 * p + 2], compare);
+        }, 1);
+        auto next = std::vector<It> {};
+        for (auto i = size_t { 0 }; i < bounds.size(); i += 2) {
+            next.emplace_back(bounds[i]);
+        }
+        if (bounds.size() % 2 == 0) {
+            next.emplace_back(bounds.back()); // odd run out, carry it to the next round
+        }
+        bounds = std::move(next);
+    }
+}
+
+// parallel sort for span
+template<typename Type, size_t Extent, typename Compare = std::greater<>>
+void parallel_sort(std::span<Type, Extent> data, Compare compare = {}, task_engine& engine = default_task_engine()) {
+    parallel_sort(data.begin(), data.end(), compare, engine);
+}
@@ -0,0 +1,168 @@
+// perf_counters.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/*
+perf_counters
+
+hardware performance counters around a region of code, via Linux perf_event_open
+counts this thread in user space only, which works with the default perf_event_paranoid=2
+
+    auto counters = perf_counters {};
+    if (counters.is_open()) {
+        counters.start();
+        work();
+        counters.stop();
+        auto c = counters.read(); // c[perf_event::cycles], ...
+    }
+
+    - all events are one group, so they are scheduled onto the PMU together and are comparable
+    - events the CPU or hypervisor doesn't expose are skipped and read back as perf_unavailable
+    - start/stop accumulate, reset() zeroes
+    - on other platforms, or without permission, is_open() is false and everything is a no-op
+*/
+
+enum class perf_event { cycles, instructions, cache_misses, branch_misses, count };
+
+constexpr auto perf_unavailable = UINT64_MAX;
+
+using perf_values = std::array<uint64_t, size_t(perf_event::count)>;
+
+constexpr std::string_view perf_event_name(perf_event e) {
+    constexpr std::string_view names[] = { "cycles", "instructions", "cache-misses", "branch-misses" };
+    return names[size_t(e)];
+}
+
+class perf_counters {
+public:
+    perf_counters();
+    ~perf_counters();
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    bool is_open() const {
+        return leader >= 0;
+    }
+    void start();
+    void stop();
+    void reset();
+    perf_values read() const;
+
+private:
+    int leader = -1;
+    std::array<int, size_t(perf_event::count)> fds;
+};
+
+#ifdef JLIB_IMPLEMENTATION
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int perf_open(uint64_t config, int group) {
+    auto attr = perf_event_attr {};
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group < 0 ? 1 : 0; // members follow the leader
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+perf_counters::perf_counters() {
+    static constexpr uint64_t configs[] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    fds.fill(-1);
+    leader = perf_open(configs[0], -1);
+    if (leader < 0) {
+        return;
+    }
+    fds[0] = leader;
+    for (auto i = size_t { 1 }; i < fds.size(); i++) {
+        fds[i] = perf_open(configs[i], leader);
+    }
+}
+
+perf_counters::~perf_counters() {
+    for (auto fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void perf_counters::start() {
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void perf_counters::stop() {
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void perf_counters::reset() {
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+perf_values perf_counters::read() const {
+    auto values = perf_values {};
+    values.fill(perf_unavailable);
+    if (leader < 0) {
+        return values;
+    }
+    // { nr, { value, id } * nr }
+    uint64_t buffer[1 + 2 * size_t(perf_event::count)] = {};
+    if (::read(leader, buffer, sizeof(buffer)) <= 0) {
+        return values;
+    }
+    // match values to events by id, skipped events leave gaps
+    for (auto i = size_t { 0 }; i < fds.size(); i++) {
+        auto id = uint64_t { 0 };
+        if (fds[i] < 0 || ioctl(fds[i], PERF_EVENT_IOC_ID, &id) < 0) {
+            continue;
+        }
+        for (auto j = uint64_t { 0 }; j < buffer[0] && j < uint64_t(perf_event::count); j++) {
+            if (buffer[2 + 2 * j] == id) {
+                values[i] = buffer[1 + 2 * j];
+            }
+        }
+    }
+    return values;
+}
+
+#else
+
+perf_counters::perf_counters() {
+    fds.fill(-1);
+}
+perf_counters::~perf_counters() {}
+void perf_counters::start() {}
+void perf_counters::stop() {}
+void perf_counters::reset() {}
+perf_values perf_counters::read() const {
+    auto values = perf_values {};
+    values.fill(perf_unavailable);
+    return values;
+}
+
+#endif
+
+#endif
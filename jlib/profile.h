@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+#if (defined JLIB_PROFILE_TSC && (defined __x86_64__ || defined _M_X64))
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define JLIB_PROFILE_USE_TSC
+#endif
+
+#ifndef paste
+#define paste(a, b) a##b
+#endif
+
+/*
+scoped profiling zones
+
+    void update() {
+        PROFILE_ZONE("update");
+        ...
+    }
+
+    - each zone records begin/end timestamps into a buffer owned by the current thread
+        (steady_clock, or the TSC if JLIB_PROFILE_TSC is defined on x86-64)
+    - profile_report() aggregates per zone: count, total, min, max and a latency_histogram
+    - write_chrome_trace() exports everything as Chrome trace JSON (chrome://tracing, perfetto)
+    - define JLIB_PROFILE_DISABLE to compile zones out entirely,
+        or set profiling_enabled() = false to stop recording at runtime
+    - each thread keeps at most profile_max_events events, later ones are counted and dropped
+*/
+
+// static per PROFILE_ZONE site
+struct profile_zone_info {
+    const char* name;
+    const char* file;
+    int line;
+    std::atomic<uint32_t> id = 0; // assigned on first use
+};
+
+struct profile_event {
+    uint32_t zone;
+    uint64_t begin; // nanoseconds
+    uint64_t end;
+};
+
+struct profile_zone_stats {
+    std::string name;
+    const char* file;
+    int line;
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    latency_histogram<> histogram; // durations in ns
+
+    double mean_ns() const {
+        return count ? double(total_ns) / count : 0.0;
+    }
+    uint64_t quantile_ns(double q) const {
+        return histogram.value_at_quantile(q);
+    }
+};
+
+constexpr size_t profile_max_events = 1 << 20;
+
+std::atomic<bool>& profiling_enabled();
+
+// current time in nanoseconds on the profiler's clock
+uint64_t profile_now();
+
+// the same clock as a chrono clock, e.g. Timer<profile_clock>
+struct profile_clock {
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::nanoseconds;
+    using time_point = std::chrono::time_point<profile_clock>;
+    static constexpr bool is_steady = true;
+    static time_point now() {
+        return time_point { duration { rep(profile_now()) } };
+    }
+};
+
+// one per thread, recording is lock-free for all practical purposes:
+// the owner takes an uncontended spin lock that only a collecting thread competes for
+struct profile_thread_buffer {
+    uint32_t thread_index = 0;
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    std::vector<profile_event> events;
+    uint64_t dropped = 0;
+
+    void record(uint32_t zone, uint64_t begin, uint64_t end) {
+        while (lock.test_and_set(std::memory_order_acquire))
+            ;
+        if (events.size() < profile_max_events) {
+            events.push_back({ zone, begin, end });
+        } else {
+            dropped++;
+        }
+        lock.clear(std::memory_order_release);
+    }
+};
+
+profile_thread_buffer& profile_this_thread();
+uint32_t profile_register_zone(profile_zone_info& zone);
+
+class profile_scope {
+public:
+    explicit profile_scope(profile_zone_info& info) {
+        if (profiling_enabled().load(std::memory_order_relaxed)) {
+            zone = info.id.load(std::memory_order_acquire);
+            if (zone == 0) {
+                zone = profile_register_zone(info);
+            }
+            begin = profile_now();
+        }
+    }
+    profile_scope(const profile_scope&) = delete;
+    profile_scope& operator=(const profile_scope&) = delete;
+    ~profile_scope() {
+        if (zone) {
+            profile_this_thread().record(zone, begin, profile_now());
+        }
+    }
+
+private:
+    uint32_t zone = 0;
+    uint64_t begin = 0;
+};
+
+// aggregate everything recorded so far, sorted by total time
+std::vector<profile_zone_stats> profile_report();
+
+// log the report, one line per zone
+void log_profile_report();
+
+// export every recorded event as Chrome trace JSON
+void write_chrome_trace(std::ostream& out);
+
+// discard all recorded events
+void profile_reset();
+
+#ifdef JLIB_PROFILE_DISABLE
+#define PROFILE_ZONE(name)
+#else
+#define JLIB_PROFILE_ZONE_IMPL(name, c)                                                            \
+    static auto paste(_profile_zone_info, c) = profile_zone_info { name, __FILE__, __LINE__ };     \
+    const auto paste(_profile_scope, c) = profile_scope { paste(_profile_zone_info, c) }
+#define PROFILE_ZONE(name) JLIB_PROFILE_ZONE_IMPL(name, __COUNTER__)
+#endif
+
+#ifdef JLIB_IMPLEMENTATION
+
+#include <thread>
+
+#include "generic_ostream.h"
+#include "log.h"
+
+struct profile_registry {
+    std::mutex lock;
+    std::vector<profile_zone_info*> zones; // id = index + 1
+    std::vector<std::shared_ptr<profile_thread_buffer>> threads;
+
+    static profile_registry& get() {
+        static auto registry = profile_registry {};
+        return registry;
+    }
+};
+
+std::atomic<bool>& profiling_enabled() {
+    static auto enabled = std::atomic<bool> { true };
+    return enabled;
+}
+
+#ifdef JLIB_PROFILE_USE_TSC
+// ticks per nanosecond, measured once against steady_clock
+static double profile_tsc_scale() {
+    static const auto scale = [] {
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto c0 = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto t1 = std::chrono::steady_clock::now();
+        const auto c1 = __rdtsc();
+        return double(c1 - c0) / std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }();
+    return scale;
+}
+uint64_t profile_now() {
+    // convert ticks since the first call: a double can't hold an absolute tick count to the nanosecond
+    static const auto scale = profile_tsc_scale();
+    static const auto base = __rdtsc();
+    return uint64_t(double(__rdtsc() - base) / scale);
+}
+#else
+uint64_t profile_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+profile_thread_buffer& profile_this_thread() {
+    thread_local auto buffer = [] {
+        auto b = std::make_shared<profile_thread_buffer>();
+        auto& r = profile_registry::get();
+        auto l = std::lock_guard { r.lock };
+        b->thread_index = r.threads.size();
+        r.threads.emplace_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+uint32_t profile_register_zone(profile_zone_info& zone) {
+    auto& r = profile_registry::get();
+    auto l = std::lock_guard { r.lock };
+    if (auto id = zone.id.load(std::memory_order_acquire)) {
+        return id;
+    }
+    r.zones.emplace_back(&zone);
+    const auto id = uint32_t(r.zones.size());
+    zone.id.store(id, std::memory_order_release);
+    return id;
+}
+
+// copy out every thread's events under its lock
+template<typename F> static void profile_for_each_thread(F&& f) {
+    auto& r = profile_registry::get();
+    auto l = std::lock_guard { r.lock };
+    for (auto& t : r.threads) {
+        while (t->lock.test_and_set(std::memory_order_acquire))
+            ;
+        f(*t);
+        t->lock.clear(std::memory_order_release);
+    }
+}
+
+std::vector<profile_zone_stats> profile_report() {
+    auto stats = std::vector<profile_zone_stats> {};
+    {
+        auto& r = profile_registry::get();
+        auto l = std::lock_guard { r.lock };
+        for (auto* z : r.zones) {
+            auto& s = stats.emplace_back();
+            s.name = z->name;
+            s.file = z->file;
+            s.line = z->line;
+        }
+    }
+    profile_for_each_thread([&](profile_thread_buffer& t) {
+        for (auto& e : t.events) {
+            if (e.zone > stats.size()) {
+                continue; // registered after we took the zone list
+            }
+            auto& s = stats[e.zone - 1];
+            const auto d = e.end - e.begin;
+            s.count++;
+            s.total_ns += d;
+            s.min_ns = std::min(s.min_ns, d);
+            s.max_ns = std::max(s.max_ns, d);
+            s.histogram.record(d);
+        }
+    });
+    std::erase_if(stats, [](auto& s) { return s.count == 0; });
+    std::sort(stats.begin(), stats.end(), [](auto& a, auto& b) { return a.total_ns > b.total_ns; });
+    return stats;
+}
+
+void log_profile_report() {
+    for (auto& s : profile_report()) {
+        log<false>(
+            s.name, log_pad { 40 }, "count ", s.count, log_pad { 60 }, "total ", s.total_ns / 1000, "us", log_pad { 80 }, "mean ",
+            uint64_t(s.mean_ns()), "ns", log_pad { 100 }, "p99 ", s.quantile_ns(0.99), "ns", log_pad { 120 }, "max ", s.max_ns, "ns"
+        );
+    }
+}
+
+void write_chrome_trace(std::ostream& out) {
+    auto names = std::vector<std::string> {};
+    {
+        auto& r = profile_registry::get();
+        auto l = std::lock_guard { r.lock };
+        for (auto* z : r.zones) {
+            names.emplace_back(z->name);
+        }
+    }
+
+    out << "{\"traceEvents\":[";
+    auto first = true;
+    profile_for_each_thread([&](profile_thread_buffer& t) {
+        for (auto& e : t.events) {
+            if (e.zone > names.size()) {
+                continue;
+            }
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            write_json_string(out, names[e.zone - 1]);
+            // chrome wants microseconds; keep the nanosecond part as a fraction
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << t.thread_index << ",\"ts\":" << e.begin / 1000 << '.' << (e.begin % 1000) / 100
+                << (e.begin % 100) / 10 << e.begin % 10 << ",\"dur\":" << (e.end - e.begin) / 1000.0 << '}';
+            first = false;
+        }
+    });
+    out << "\n]}\n";
+}
+
+void profile_reset() {
+    profile_for_each_thread([](profile_thread_buffer& t) {
+        t.events.clear();
+        t.dropped = 0;
+    });
+}
+
+#endif
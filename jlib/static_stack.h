@@ -4,6 +4,7 @@
 #include <array>
 #include <cstddef>
 #include <stdexcept>
+#include <utility>
 
 template<typename T, size_t N> struct static_stack final : public std::array<T, N> {
     size_t count = 0;
@@ -15,6 +16,13 @@ template<typename T, size_t N> struct static_stack final : public std::array<T,
         (*this)[count++] = t;
     }
 
+    void push_back(T&& t) {
+        if (count == N) {
+            throw std::runtime_error("static_stack ran out of space");
+        }
+        (*this)[count++] = std::move(t);
+    }
+
     template<typename... Args> void emplace_back(Args&&... args) {
         if (count == N) {
             throw std::runtime_error("static_stack ran out of space");
@@ -169,6 +169,11 @@ public:
             if (index == storage.size() - 1) {
                 // better not to record free slots past the end of storage
                 storage.pop_back();
+                // which also goes for the free slots this uncovers, or begin() would run past end()
+                while (!storage.empty() && !is_busy[storage.size() - 1]) {
+                    std::erase(free_slots, storage.size() - 1);
+                    storage.pop_back();
+                }
             } else {
                 free_slots.emplace_back(index);
             }
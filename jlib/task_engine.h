@@ -0,0 +1,394 @@
+// task_engine.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+task_engine
+
+work-stealing thread pool
+    - one Chase-Lev deque per worker: the owner pushes/pops at the bottom, idle workers steal from the top
+    - tasks submitted from outside the pool go through a shared injection queue
+    - workers with nothing to do park on a condition variable and are woken by submit()
+    - wait_group counts outstanding tasks; waiting from inside a worker runs other tasks
+        instead of blocking, so nested parallelism can't starve the pool
+
+Limitations: tasks must not throw, an exception escaping a task terminates (same as std::thread)
+
+usage:
+
+    auto engine = task_engine {};
+    auto group = wait_group {};
+    engine.submit(group, [&] { ... });
+    engine.wait(group);
+
+    parallel_for(engine, 0, items.size(), [&](size_t i) { process(items[i]); });
+*/
+
+// Chase-Lev work-stealing deque of pointers
+// push/pop by the owning thread only, steal from any thread
+// ("Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013)
+template<typename T> class work_stealing_deque {
+    static_assert(std::is_pointer_v<T>, "work_stealing_deque stores pointers");
+
+public:
+    explicit work_stealing_deque(int64_t capacity = 256) {
+        auto r = std::make_unique<ring>(std::max(capacity, int64_t { 2 }));
+        array.store(r.get(), std::memory_order_relaxed);
+        rings.emplace_back(std::move(r));
+    }
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // owner only
+    void push(T item) {
+        const auto b = bottom.load(std::memory_order_relaxed);
+        const auto t = top.load(std::memory_order_acquire);
+        auto* a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only; returns nullptr if empty
+    T pop() {
+        const auto b = bottom.load(std::memory_order_relaxed) - 1;
+        auto* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+
+        auto item = T { nullptr };
+        if (t <= b) {
+            item = a->get(b);
+            if (t == b) {
+                // last element, race against thieves for it
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // any thread; returns nullptr if empty or if another thief won the race
+    T steal() {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        auto* a = array.load(std::memory_order_acquire);
+        auto item = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct ring {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit ring(int64_t capacity): capacity(capacity), items(std::make_unique<std::atomic<T>[]>(capacity)) {}
+        T get(int64_t i) const {
+            return items[i % capacity].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, T item) {
+            items[i % capacity].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    ring* grow(ring* old, int64_t t, int64_t b) {
+        auto r = std::make_unique<ring>(old->capacity * 2);
+        for (auto i = t; i < b; i++) {
+            r->put(i, old->get(i));
+        }
+        // thieves may still be reading the old ring, keep it alive until the deque dies
+        auto* next = r.get();
+        rings.emplace_back(std::move(r));
+        array.store(next, std::memory_order_release);
+        return next;
+    }
+
+    alignas(64) std::atomic<int64_t> top = 0;
+    alignas(64) std::atomic<int64_t> bottom = 0;
+    std::atomic<ring*> array;
+    std::vector<std::unique_ptr<ring>> rings; // owner only
+};
+
+// counts outstanding tasks
+// the last done() notifies while holding the lock, and finished()/wait() take the same lock,
+// so once a waiter sees zero no done() is still touching the group and it can be destroyed
+class wait_group {
+public:
+    wait_group() = default;
+    wait_group(const wait_group&) = delete;
+    wait_group& operator=(const wait_group&) = delete;
+
+    void add(int64_t n = 1) {
+        auto lock = std::lock_guard { mutex };
+        count += n;
+    }
+    void done() {
+        auto lock = std::lock_guard { mutex };
+        if (--count == 0) {
+            cv.notify_all();
+        }
+    }
+    bool finished() const {
+        auto lock = std::lock_guard { mutex };
+        return count == 0;
+    }
+
+    // block until the count reaches zero
+    // from inside a task_engine worker use task_engine::wait instead
+    void wait() const {
+        auto lock = std::unique_lock { mutex };
+        cv.wait(lock, [this] { return count == 0; });
+    }
+
+private:
+    mutable std::mutex mutex;
+    mutable std::condition_variable cv;
+    int64_t count = 0;
+};
+
+class task_engine {
+public:
+    explicit task_engine(size_t num_workers = std::thread::hardware_concurrency()) {
+        num_workers = std::max(num_workers, size_t { 1 });
+        for (auto i = 0u; i < num_workers; i++) {
+            workers.emplace_back(std::make_unique<worker>());
+        }
+        for (auto i = 0u; i < num_workers; i++) {
+            workers[i]->thread = std::thread([this, i] { run_worker(i); });
+        }
+    }
+    task_engine(const task_engine&) = delete;
+    task_engine& operator=(const task_engine&) = delete;
+
+    // finishes all queued tasks, then joins the workers
+    ~task_engine() {
+        {
+            auto lock = std::lock_guard { park_lock };
+            stopping.store(true);
+            epoch++;
+        }
+        park_cv.notify_all();
+        for (auto& w : workers) {
+            w->thread.join();
+        }
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // true if the calling thread is one of this engine's workers
+    bool in_worker() const {
+        return current_engine() == this;
+    }
+
+    template<typename F> void submit(F&& f) {
+        enqueue(new task { std::forward<F>(f), nullptr });
+    }
+
+    // submit a task counted by group; group.done() is called after it runs
+    template<typename F> void submit(wait_group& group, F&& f) {
+        group.add();
+        enqueue(new task { std::forward<F>(f), &group });
+    }
+
+    // wait for group to finish
+    // workers run other tasks while they wait, external threads block
+    void wait(wait_group& group) {
+        if (!in_worker()) {
+            group.wait();
+            return;
+        }
+        while (!group.finished()) {
+            if (!run_one(current_index())) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct task {
+        std::function<void()> func;
+        wait_group* group;
+    };
+
+    struct worker {
+        work_stealing_deque<task*> deque;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<worker>> workers;
+
+    std::mutex inject_lock;
+    std::deque<task*> inject;
+
+    std::mutex park_lock;
+    std::condition_variable park_cv;
+    std::atomic<uint64_t> epoch = 0;
+    std::atomic<int> sleepers = 0;
+    std::atomic<bool> stopping = false;
+
+    static const task_engine*& current_engine() {
+        thread_local const task_engine* engine = nullptr;
+        return engine;
+    }
+    static size_t& current_index() {
+        thread_local size_t index = 0;
+        return index;
+    }
+
+    void enqueue(task* t) {
+        if (in_worker()) {
+            workers[current_index()]->deque.push(t);
+        } else {
+            auto lock = std::lock_guard { inject_lock };
+            inject.emplace_back(t);
+        }
+
+        // pairs with the sleepers increment in run_worker:
+        // either we see the sleeper and bump the epoch, or its last search sees our task
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) > 0) {
+            {
+                auto lock = std::lock_guard { park_lock };
+                epoch++;
+            }
+            park_cv.notify_one();
+        }
+    }
+
+    task* find_task(size_t index) {
+        if (auto* t = workers[index]->deque.pop()) {
+            return t;
+        }
+        {
+            auto lock = std::lock_guard { inject_lock };
+            if (inject.size()) {
+                auto* t = inject.front();
+                inject.pop_front();
+                return t;
+            }
+        }
+        // steal, starting from the next worker so victims are spread out
+        const auto n = workers.size();
+        for (auto i = 1u; i < n; i++) {
+            if (auto* t = workers[(index + i) % n]->deque.steal()) {
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    static void execute(task* t) {
+        t->func();
+        auto* group = t->group;
+        delete t;
+        if (group) {
+            group->done();
+        }
+    }
+
+    bool run_one(size_t index) {
+        if (auto* t = find_task(index)) {
+            execute(t);
+            return true;
+        }
+        return false;
+    }
+
+    void run_worker(size_t index) {
+        current_engine() = this;
+        current_index() = index;
+
+        while (true) {
+            // spin a little before parking
+            auto found = false;
+            for (auto spin = 0; spin < 64 && !found; spin++) {
+                found = run_one(index);
+            }
+            if (found) {
+                continue;
+            }
+
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            const auto e = epoch.load(std::memory_order_seq_cst);
+            if (auto* t = find_task(index)) {
+                sleepers.fetch_sub(1, std::memory_order_seq_cst);
+                execute(t);
+                continue;
+            }
+            if (stopping.load()) {
+                sleepers.fetch_sub(1, std::memory_order_seq_cst);
+                return;
+            }
+            {
+                auto lock = std::unique_lock { park_lock };
+                park_cv.wait(lock, [&] { return epoch.load() != e; });
+            }
+            sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+};
+
+// shared engine with one worker per hardware thread, created on first use
+inline task_engine& default_task_engine() {
+    static auto engine = task_engine {};
+    return engine;
+}
+
+// call f(i) for every i in [begin, end), spread across the engine in chunks of grain
+// grain = 0 picks a chunk size that gives each worker a few chunks to balance with
+// returns once every call has finished
+template<typename F> void parallel_for(task_engine& engine, size_t begin, size_t end, F&& f, size_t grain = 0) {
+    if (begin >= end) {
+        return;
+    }
+    const auto count = end - begin;
+    if (grain == 0) {
+        grain = std::max(count / (engine.size() * 4), size_t { 1 });
+    }
+
+    auto group = wait_group {};
+    for (auto chunk = begin; chunk < end; chunk += grain) {
+        const auto chunk_end = std::min(chunk + grain, end);
+        engine.submit(group, [&f, chunk, chunk_end] {
+            for (auto i = chunk; i < chunk_end; i++) {
+                f(i);
+            }
+        });
+    }
+    engine.wait(group);
+}
+
+template<typename F> void parallel_for(size_t begin, size_t end, F&& f, size_t grain = 0) {
+    parallel_for(default_task_engine(), begin, end, std::forward<F>(f), grain);
+}
@@ -16,6 +16,17 @@ usage:
     - build and run with the macro ENABLE_TEST defined
         it will run all tests instead of the program
         you can run tests in debug and release mode
+    - run_tests(parse_test_args(argc, argv)) understands:
+        test_file_stem ...      only tests from those files
+        --filter=GLOB           only tests whose name or file stem matches (* and ?), repeatable
+        -j, -jN, --jobs=N       run files in parallel on N threads (all cores for plain -j)
+                                each test's log output is buffered and printed when it finishes
+        --slowest=N             list the N slowest tests at the end (default 5, 0 to disable)
+        --isolate               fork every test into its own process (POSIX), so a crash or a hang
+                                fails that test instead of the run; -j runs N children at once
+        --timeout=SECONDS       kill isolated tests that run longer (default 60, implies --isolate)
+    - tests that touch process-wide state (log sinks, log levels, std::cerr...) should use
+        TEST_SERIAL() instead: they run one at a time after the parallel ones, uncaptured
 
 example:
 
@@ -47,8 +58,10 @@ example:
 #include "terminal_color.h"
 
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <string>
 #include <vector>
 
 // util
@@ -80,23 +93,33 @@ struct TestBase {
     const char* msg;
     const char* file;
     int line;
+    bool serial;
+    double seconds = 0; // duration of the last run
 
-    inline TestBase(const char* msg, const char* file, int line):
+    inline TestBase(const char* msg, const char* file, int line, bool serial = false, bool registered = true):
         msg(msg),
         file(file),
-        line(line) {
-        ALL_TESTS().push_back(this);
+        line(line),
+        serial(serial) {
+        if (registered) {
+            ALL_TESTS().push_back(this);
+        }
     }
+    virtual ~TestBase() = default;
 
     inline bool operator()() {
+        const auto start = std::chrono::steady_clock::now();
+        auto error = std::string {};
+        auto success = true;
         try {
             func();
-            report(true, nullptr);
-            return true;
         } catch (std::exception& e) {
-            report(false, e.what());
-            return false;
+            success = false;
+            error = e.what();
         }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        report(success, success ? nullptr : error.c_str());
+        return success;
     }
 
     inline void report(bool success, const char* error) {
@@ -106,12 +129,17 @@ struct TestBase {
 
         // if running in VScode, do special formatting so it looks like GCC output
         // this allows the user to double click a failing test to go to the source
+        const auto ms = double(uint64_t(seconds * 10'000)) / 10;
         if (auto env = std::getenv("TERM_PROGRAM"); env && env == std::string { "vscode" }) {
-            log<false, false>(file, ":", line, color, message, Colors::FG_DEFAULT, msg, error ? ": " : "", error ? error : "");
+            log<false, false>(
+                file, ":", line, color, message, Colors::FG_DEFAULT, msg, error ? ": " : "", error ? error : "", Colors::FG_BLACK2, " (", ms,
+                "ms)", Colors::FG_DEFAULT
+            );
         } else {
             auto filename = std::filesystem::path(file).filename().string();
             log<false, false>(
-                Colors::FG_CYAN2, filename, ":", line, color, message, Colors::FG_DEFAULT, msg, error ? ": " : "", error ? error : ""
+                Colors::FG_CYAN2, filename, ":", line, color, message, Colors::FG_DEFAULT, msg, error ? ": " : "", error ? error : "",
+                Colors::FG_BLACK2, " (", ms, "ms)", Colors::FG_DEFAULT
             );
         }
     }
@@ -127,8 +155,8 @@ struct TestBase {
 // };
 template <size_t Counter, size_t Line>
 struct Test final: public TestBase {
-    Test(const char* file, const char* msg):
-        TestBase(msg, file, Line) {}
+    Test(const char* file, const char* msg, bool serial = false):
+        TestBase(msg, file, Line, serial) {}
 
     virtual void func() override;
 };
@@ -141,19 +169,53 @@ constexpr inline uint32_t comptime_hash(const char* s) {
     return hash;
 }
 
-#    define TEST_(file, line, counter, ...)                                           \
-        static auto paste(__test_, counter) = Test<counter + comptime_hash(file), line>(file, __VA_ARGS__); \
+#    define TEST_(file, line, counter, serial, msg)                                  \
+        static auto paste(__test_, counter) = Test<counter + comptime_hash(file), line>(file, msg, serial); \
         template <>                                                                   \
         void Test<counter + comptime_hash(file), line>::func()
-#    define TEST(...) TEST_(__FILE__, __LINE__, __COUNTER__, __VA_ARGS__)
+#    define TEST(msg) TEST_(__FILE__, __LINE__, __COUNTER__, false, msg)
+#    define TEST_SERIAL(msg) TEST_(__FILE__, __LINE__, __COUNTER__, true, msg)
 #    define CHECK(...)                                                                \
-        TEST_(__FILE__, __LINE__, __COUNTER__, #__VA_ARGS__) { ASSERT(__VA_ARGS__); }
+        TEST_(__FILE__, __LINE__, __COUNTER__, false, #__VA_ARGS__) { ASSERT(__VA_ARGS__); }
 
 #else
 #    define TEST(...)
+#    define TEST_SERIAL(...)
 #    define CHECK(...)
 #endif
 
+struct test_options {
+    std::vector<std::string> stems; // file stems, empty for all
+    std::vector<std::string> filters; // globs on test name or file stem, empty for all
+    size_t jobs = 1;
+    size_t slowest = 5;
+    bool isolate = false;
+    double timeout = 60; // seconds, isolated tests only, 0 for none
+};
+
+#ifdef ENABLE_TEST
+enum class test_status { passed, failed, crashed, timed_out };
+
+struct test_outcome {
+    test_status status = test_status::failed;
+    int signal = 0; // when crashed
+    std::string output; // everything the test wrote to stdout and stderr, including its report line
+};
+
+// run one test in a forked child with a timeout, without reporting it
+// where fork isn't available the test runs in-process and can't time out
+test_outcome run_test_isolated(TestBase& test, double timeout_seconds);
+#endif
+
+test_options parse_test_args(int argc, char* argv[]);
+
+// '*' matches any run of characters, '?' any one character
+bool test_glob_match(std::string_view pattern, std::string_view text);
+
+// returns true if every selected test passed
+int run_tests(const test_options& options);
+int run_tests(const std::vector<std::string_view>& subset);
+
 #ifdef JLIB_TEST_IMPLEMENTATION
 
 std::vector<TestBase*>& ALL_TESTS() {
@@ -161,26 +223,320 @@ std::vector<TestBase*>& ALL_TESTS() {
     return all_tests;
 }
 
-int run_tests(const std::vector<std::string_view>& subset) {
+test_options parse_test_args(int argc, char* argv[]) {
+    auto options = test_options {};
+    for (auto i = 1; i < argc; i++) {
+        const auto arg = std::string_view { argv[i] };
+        if (arg.starts_with("--filter=")) {
+            options.filters.emplace_back(arg.substr(9));
+        } else if (arg.starts_with("--jobs=")) {
+            options.jobs = std::max(1, std::atoi(arg.data() + 7));
+        } else if (arg == "-j") {
+            options.jobs = std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg.starts_with("-j")) {
+            options.jobs = std::max(1, std::atoi(arg.data() + 2));
+        } else if (arg == "--isolate") {
+            options.isolate = true;
+        } else if (arg.starts_with("--timeout=")) {
+            options.isolate = true;
+            options.timeout = std::atof(arg.data() + 10);
+        } else if (arg.starts_with("--slowest=")) {
+            options.slowest = size_t(std::max(0, std::atoi(arg.data() + 10)));
+        } else {
+            options.stems.emplace_back(arg);
+        }
+    }
+    return options;
+}
+
+bool test_glob_match(std::string_view pattern, std::string_view text) {
+    // greedy with backtracking to the last star
+    auto p = size_t { 0 };
+    auto t = size_t { 0 };
+    auto star = std::string_view::npos;
+    auto star_t = size_t { 0 };
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            p++;
+            t++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_t = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++star_t;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+#if (defined __unix__ || defined __APPLE__)
+#define JLIB_TEST_FORK
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// run tests in child processes, at most jobs at a time, calling done(test, outcome) as each finishes
+// the parent stays single threaded: children are multiplexed with poll(), so forking is safe
+template<typename Done> static void run_isolated(const std::vector<TestBase*>& tests, size_t jobs, double timeout, Done&& done) {
+#ifdef JLIB_TEST_FORK
+    using clock = std::chrono::steady_clock;
+    struct child {
+        TestBase* test;
+        pid_t pid;
+        int fd;
+        clock::time_point start;
+        test_outcome outcome;
+        bool killed = false;
+    };
+    auto running = std::vector<child> {};
+    auto next = size_t { 0 };
+    const auto limit = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(timeout));
+
+    auto spawn = [&](TestBase* t) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            throw std::runtime_error("pipe() failed");
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(nullptr);
+        const auto pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("fork() failed");
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            dup2(fds[1], STDOUT_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+            close(fds[1]);
+            const auto ok = (*t)();
+            std::cout.flush();
+            std::cerr.flush();
+            flush_log_sinks();
+            fflush(nullptr);
+            _exit(ok ? 0 : 1);
+        }
+        close(fds[1]);
+        running.push_back({ t, pid, fds[0], clock::now(), {} });
+    };
+
+    // status as returned by waitpid
+    auto finish = [&](size_t i, int status) {
+        auto& c = running[i];
+        if (c.fd >= 0) {
+            close(c.fd);
+        }
+        if (c.killed) {
+            c.outcome.status = test_status::timed_out;
+        } else if (WIFSIGNALED(status)) {
+            c.outcome.status = test_status::crashed;
+            c.outcome.signal = WTERMSIG(status);
+        } else {
+            c.outcome.status = WIFEXITED(status) && WEXITSTATUS(status) == 0 ? test_status::passed : test_status::failed;
+        }
+        c.test->seconds = std::chrono::duration<double>(clock::now() - c.start).count();
+        auto finished = std::move(c);
+        running.erase(running.begin() + i);
+        done(*finished.test, finished.outcome);
+    };
+
+    while (next < tests.size() || running.size()) {
+        while (running.size() < std::max<size_t>(jobs, 1) && next < tests.size()) {
+            spawn(tests[next++]);
+        }
+
+        // wake up for output, or in time for the nearest deadline
+        // children that closed their output can't wake us, so poll them for exit every few ms
+        auto wait_ms = 1000;
+        for (auto& c : running) {
+            if (timeout > 0) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(c.start + limit - clock::now()).count();
+                wait_ms = int(std::clamp<int64_t>(left + 1, 0, wait_ms));
+            }
+            if (c.fd < 0) {
+                wait_ms = std::min(wait_ms, 10);
+            }
+        }
+        auto polls = std::vector<pollfd> {};
+        for (auto& c : running) {
+            polls.push_back({ c.fd, POLLIN, 0 }); // negative fds are ignored
+        }
+        poll(polls.data(), polls.size(), wait_ms);
+
+        for (auto i = running.size(); i-- > 0;) {
+            auto& c = running[i];
+            if (c.fd >= 0 && (polls[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                char buffer[4096];
+                const auto n = read(c.fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    c.outcome.output.append(buffer, size_t(n));
+                } else {
+                    // eof: the child exited, or closed its output and may still be running
+                    close(c.fd);
+                    c.fd = -1;
+                }
+            }
+            auto status = 0;
+            if (c.fd < 0 && waitpid(c.pid, &status, WNOHANG) == c.pid) {
+                finish(i, status);
+                continue;
+            }
+            // checked even while the child is writing, a runaway test usually is
+            if (timeout > 0 && clock::now() - c.start > limit) {
+                kill(c.pid, SIGKILL);
+                c.killed = true;
+                waitpid(c.pid, &status, 0);
+                finish(i, status);
+            }
+        }
+    }
+#else
+    (void)jobs;
+    (void)timeout;
+    for (auto* t : tests) {
+        auto outcome = test_outcome {};
+        {
+            auto capture = log_capture_scope {};
+            outcome.status = (*t)() ? test_status::passed : test_status::failed;
+            outcome.output = std::move(capture.text);
+        }
+        done(*t, outcome);
+    }
+#endif
+}
+
+test_outcome run_test_isolated(TestBase& test, double timeout_seconds) {
+    auto result = test_outcome {};
+    run_isolated({ &test }, 1, timeout_seconds, [&](TestBase&, test_outcome& outcome) { result = std::move(outcome); });
+    return result;
+}
+
+// output, then a report line for deaths the child couldn't report itself
+static bool report_isolated(TestBase& t, const test_outcome& outcome, double timeout) {
+    log_write(outcome.output);
+    if (outcome.status == test_status::crashed) {
+#ifdef JLIB_TEST_FORK
+        const auto* name = strsignal(outcome.signal);
+#else
+        const auto* name = "";
+#endif
+        const auto error = "crashed with signal " + std::to_string(outcome.signal) + " (" + (name ? name : "?") + ")";
+        t.report(false, error.c_str());
+    } else if (outcome.status == test_status::timed_out) {
+        char seconds[32];
+        const auto [end, ec] = std::to_chars(seconds, seconds + sizeof(seconds), timeout);
+        const auto error = "timed out after " + std::string(seconds, end) + "s";
+        t.report(false, error.c_str());
+    }
+    return outcome.status == test_status::passed;
+}
+
+int run_tests(const test_options& options) {
     log(Colors::FG_YELLOW2, "Running tests", Colors::FG_DEFAULT);
-    auto passed = 0;
 
-    // if a subset is passed, remove tests not in the subset
-    if (subset.size()) {
-        std::erase_if(ALL_TESTS(), [&](auto& t) {
-            auto stem = std::filesystem::path { t->file }.stem().string();
-            return std::find(subset.begin(), subset.end(), std::string_view { stem }) == subset.end();
-        });
+    auto selected = std::vector<TestBase*> {};
+    for (auto* t : ALL_TESTS()) {
+        const auto stem = std::filesystem::path { t->file }.stem().string();
+        const auto& stems = options.stems;
+        if (stems.size() && std::find(stems.begin(), stems.end(), stem) == stems.end()) {
+            continue;
+        }
+        const auto& filters = options.filters;
+        if (filters.size() && std::none_of(filters.begin(), filters.end(), [&](auto& f) {
+                return test_glob_match(f, t->msg) || test_glob_match(f, stem);
+            })) {
+            continue;
+        }
+        selected.push_back(t);
     }
 
-    for (auto& t : ALL_TESTS()) {
+    // tests from one file stay in order on one thread, files run in parallel
+    auto files = std::vector<std::vector<TestBase*>> {};
+    auto serial = std::vector<TestBase*> {};
+    for (auto* t : selected) {
+        if (t->serial) {
+            serial.push_back(t);
+        } else if (files.size() && files.back().front()->file == std::string_view { t->file }) {
+            files.back().push_back(t);
+        } else {
+            files.push_back({ t });
+        }
+    }
+
+    auto passed = std::atomic<size_t> { 0 };
+    if (options.isolate) {
+        // every test gets a fresh process, so only serial tests need to wait for each other
+        auto parallel = std::vector<TestBase*> {};
+        for (auto& file : files) {
+            parallel.insert(parallel.end(), file.begin(), file.end());
+        }
+        auto report = [&](TestBase& t, const test_outcome& outcome) {
+            passed += report_isolated(t, outcome, options.timeout) ? 1 : 0;
+        };
+        run_isolated(parallel, options.jobs, options.timeout, report);
+        run_isolated(serial, 1, options.timeout, report);
+        serial.clear();
+    } else if (options.jobs <= 1) {
+        for (auto& file : files) {
+            for (auto* t : file) {
+                passed += (*t)() ? 1 : 0;
+            }
+        }
+    } else {
+        auto next = std::atomic<size_t> { 0 };
+        auto workers = std::vector<std::jthread> {};
+        for (auto w = size_t { 0 }; w < std::min(options.jobs, files.size()); w++) {
+            workers.emplace_back([&] {
+                for (auto f = next++; f < files.size(); f = next++) {
+                    for (auto* t : files[f]) {
+                        auto output = std::string {};
+                        {
+                            auto capture = log_capture_scope {};
+                            passed += (*t)() ? 1 : 0;
+                            output = std::move(capture.text);
+                        }
+                        log_write(output);
+                    }
+                }
+            });
+        }
+    }
+    for (auto* t : serial) {
         passed += (*t)() ? 1 : 0;
-        // log("test: ", t->file, t->line, t->msg);
-        // log("test", std::filesystem::path { t->file }.stem(), t->line, t->msg);
     }
-    auto failed = ALL_TESTS().size() - passed;
-    log<false>(Colors::FG_YELLOW2, "Tests complete", Colors::FG_DEFAULT, ": ", passed, " passed, ", failed, " failed");
+
+    if (options.slowest && selected.size()) {
+        auto slowest = selected;
+        const auto n = std::min(options.slowest, slowest.size());
+        std::partial_sort(slowest.begin(), slowest.begin() + n, slowest.end(), [](auto* a, auto* b) { return a->seconds > b->seconds; });
+        log<false>(Colors::FG_YELLOW2, "Slowest tests", Colors::FG_DEFAULT, ":");
+        for (auto i = size_t { 0 }; i < n; i++) {
+            auto* t = slowest[i];
+            const auto filename = std::filesystem::path(t->file).filename().string();
+            log<false>("    ", double(uint64_t(t->seconds * 10'000)) / 10, "ms", log_pad { 16 }, filename, ":", t->line, " ", t->msg);
+        }
+    }
+
+    const auto failed = selected.size() - passed;
+    log<false>(Colors::FG_YELLOW2, "Tests complete", Colors::FG_DEFAULT, ": ", passed.load(), " passed, ", failed, " failed");
 
     return failed == 0;
 }
+
+int run_tests(const std::vector<std::string_view>& subset) {
+    auto options = test_options {};
+    for (auto s : subset) {
+        options.stems.emplace_back(s);
+    }
+    return run_tests(options);
+}
 #endif
@@ -0,0 +1,111 @@
+// top_k.h
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <ranges>
+#include <vector>
+
+#include "heapsort.h"
+
+/*
+top_k<T, K, Compare>
+
+keeps the best K elements seen from a stream, in fixed storage
+"best" follows the heap convention: Compare(a, b) == true means a ranks above b
+so the default std::greater keeps the K largest
+
+internally a static_heap ordered worst-first, so the element to evict is always on top
+    - push: O(1) when the element doesn't make the cut, O(log K) otherwise
+    - merge: combine per-thread results, O(K log K)
+*/
+
+template<typename T, size_t K, typename Compare = std::greater<T>> class top_k {
+    static_assert(K > 0, "top_k needs room for at least one element");
+
+    // reversed comparison: the worst element of the kept set is on top
+    struct worst_first {
+        Compare compare;
+        bool operator()(const T& a, const T& b) const {
+            return compare(b, a);
+        }
+    };
+
+public:
+    using value_type = T;
+
+    size_t size() const {
+        return kept.get_count();
+    }
+    bool empty() const {
+        return kept.empty();
+    }
+    bool full() const {
+        return size() == K;
+    }
+    static constexpr size_t capacity() {
+        return K;
+    }
+
+    // the element that would be evicted next, ie. the threshold a new element has to beat once full
+    const T& worst() const {
+        return kept.top();
+    }
+
+    // offer an element; returns true if it was kept
+    bool push(const T& t) {
+        if (!full()) {
+            kept.push(t);
+            return true;
+        }
+        if (!compare(t, kept.top())) {
+            return false;
+        }
+        kept.replace_top(t);
+        return true;
+    }
+    bool push(T&& t) {
+        if (!full()) {
+            kept.push(std::move(t));
+            return true;
+        }
+        if (!compare(t, kept.top())) {
+            return false;
+        }
+        kept.replace_top(std::move(t));
+        return true;
+    }
+
+    // fold another top_k (eg. from another thread) into this one
+    template<size_t K2> void merge(const top_k<T, K2, Compare>& other) {
+        for (auto i = 0u; i < other.size(); i++) {
+            push(other.kept.store[i]);
+        }
+    }
+
+    // kept elements, best first
+    std::vector<T> sorted() const {
+        auto result = std::vector<T>(kept.store.begin(), kept.store.begin() + size());
+        std::sort(result.begin(), result.end(), compare);
+        return result;
+    }
+
+    void clear() {
+        kept = {};
+    }
+
+private:
+    template<typename, size_t, typename> friend class top_k;
+
+    static_heap<T, K, worst_first> kept;
+    Compare compare;
+};
+
+// merge any number of top_k results (eg. one per thread) into one
+template<typename Range> auto merge_top_k(const Range& parts) {
+    auto result = std::ranges::range_value_t<Range> {};
+    for (auto& part : parts) {
+        result.merge(part);
+    }
+    return result;
+}
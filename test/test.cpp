@@ -4,6 +4,6 @@
 #include <jlib/jlib_all.h>
 
 int main(int argc, char* argv[]) {
-    run_tests(std::vector<std::string_view> { argv+1, argv + argc });
+    run_tests(parse_test_args(argc, argv));
     return 0;
 }
@@ -0,0 +1,118 @@
+#include <jlib/bench_report.h>
+#include <jlib/test_framework.h>
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+static bench_result fake_result(std::string name, double center, double spread) {
+    auto r = bench_result {};
+    r.name = std::move(name);
+    r.iterations = 100;
+    for (auto i = 0; i < 30; i++) {
+        r.samples.push_back(center + spread * ((i * 7) % 30 - 15) / 15.0);
+    }
+    bench_summarize(r);
+    return r;
+}
+
+TEST("bench json round trip") {
+    auto results = std::vector<bench_result> { fake_result("a \"quoted\" name", 100, 5), fake_result("b", 2.5e6, 1e4) };
+    results[1].items_per_iteration = 1000;
+    results[1].counters = { 1000, 2500, 3.25, -1 };
+    auto out = std::stringstream {};
+    write_bench_json(out, results);
+    const auto back = read_bench_json(out);
+    ASSERT(back.size() == 2);
+    ASSERT(back[0].name == "a \"quoted\" name");
+    ASSERT(back[0].samples == results[0].samples);
+    ASSERT(back[0].median == results[0].median);
+    ASSERT(back[0].ci_high == results[0].ci_high);
+    ASSERT(!back[0].has_counters());
+    ASSERT(back[1].items_per_iteration == 1000);
+    ASSERT(back[1].counters[2] == 3.25);
+    ASSERT(back[1].counters[3] < 0);
+
+    auto bad = std::stringstream { "{\"benchmarks\":[{\"name\":1}]}" };
+    ASSERT_THROWS(read_bench_json(bad));
+}
+
+TEST("bench json writes non-finite values as null") {
+    auto r = fake_result("degenerate", 100, 5);
+    r.mad = std::numeric_limits<double>::quiet_NaN();
+    r.max = std::numeric_limits<double>::infinity();
+    r.samples.back() = -std::numeric_limits<double>::infinity();
+    auto out = std::stringstream {};
+    write_bench_json(out, { r });
+    ASSERT(out.str().find("\"mad_ns\":null") != std::string::npos);
+    ASSERT(out.str().find("inf") == std::string::npos && out.str().find("nan") == std::string::npos);
+
+    const auto back = read_bench_json(out);
+    ASSERT(back.size() == 1);
+    ASSERT(std::isnan(back[0].mad) && std::isnan(back[0].max) && std::isnan(back[0].samples.back()));
+    ASSERT(back[0].median == r.median);
+}
+
+TEST("bench csv") {
+    auto out = std::stringstream {};
+    write_bench_csv(out, { fake_result("x", 10, 0) });
+    auto header = std::string {};
+    auto row = std::string {};
+    std::getline(out, header);
+    std::getline(out, row);
+    ASSERT(header.starts_with("name,iterations,items_per_iteration,median_ns"));
+    ASSERT(row.starts_with("\"x\",100,0,10,"));
+}
+
+TEST("bench comparison flags significant regressions only") {
+    const auto baseline = std::vector<bench_result> {
+        fake_result("stable", 100, 5),
+        fake_result("slower", 100, 2),
+        fake_result("faster", 100, 2),
+        fake_result("tiny change", 100, 2),
+    };
+    const auto current = std::vector<bench_result> {
+        fake_result("stable", 101, 5),
+        fake_result("slower", 130, 2),
+        fake_result("faster", 70, 2),
+        fake_result("tiny change", 102, 0.1),
+        fake_result("new", 1, 1),
+    };
+    const auto c = compare_benchmarks(baseline, current);
+    ASSERT(c.size() == 4);
+    ASSERT(c[0].verdict == bench_verdict::same);
+    ASSERT(c[1].verdict == bench_verdict::regression && c[1].p_value < 1e-6);
+    ASSERT(c[2].verdict == bench_verdict::improvement);
+    ASSERT(c[3].verdict == bench_verdict::same); // significant but under the threshold
+    ASSERT(c[3].p_value < 0.01);
+}
+
+TEST("bench comparison reports missing benchmarks") {
+    const auto baseline = std::vector<bench_result> { fake_result("kept", 100, 2), fake_result("renamed", 100, 2) };
+    const auto current = std::vector<bench_result> { fake_result("kept", 100, 2), fake_result("new name", 300, 2) };
+    const auto c = compare_benchmarks(baseline, current);
+    ASSERT(c.size() == 2);
+    ASSERT(c[0].name == "kept" && c[0].verdict == bench_verdict::same);
+    ASSERT(c[1].name == "renamed" && c[1].verdict == bench_verdict::missing);
+    ASSERT(log_bench_comparison(c) == 1);
+}
+
+TEST("mann whitney") {
+    const auto a = std::vector<double> { 1, 2, 3, 4, 5 };
+    ASSERT(bench_mann_whitney_p(a, a) > 0.9);
+    ASSERT(bench_mann_whitney_p({ 1, 1, 1 }, { 1, 1, 1 }) == 1.0);
+    ASSERT(bench_mann_whitney_p(a, { 10, 11, 12, 13, 14 }) < 0.05);
+}
+
+TEST("bench body that never loops is an error") {
+    const auto options = bench_options { .warmup = std::chrono::milliseconds(1), .sample_time = std::chrono::microseconds(100), .samples = 3 };
+    const auto idle = run_bench({ "idle", [](bench_state&) {} }, options);
+    ASSERT(!idle.error.empty() && idle.samples.empty());
+
+    const auto busy = run_bench({ "busy", [](bench_state& state) {
+        for (auto _ : state) {
+            do_not_optimize(state.iterations());
+        }
+    } }, options);
+    ASSERT(busy.error.empty() && busy.samples.size() == 3);
+}
@@ -0,0 +1,72 @@
+#include <jlib/concurrent_heap.h>
+#include <jlib/test_framework.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST("concurrent priority queue single thread") {
+    auto q = concurrent_priority_queue<int, std::less<int>> { 4 };
+    auto out = 0;
+    ASSERT(!q.try_pop(out));
+    for (auto i = 0; i < 100; i++) {
+        q.push(i);
+    }
+    ASSERT(q.size() == 100);
+
+    auto popped = std::vector<int> {};
+    while (q.try_pop(out)) {
+        popped.emplace_back(out);
+    }
+    ASSERT(popped.size() == 100);
+    ASSERT(q.empty());
+
+    // relaxed ordering, but the first pops should still come from near the front
+    ASSERT(popped.front() < 50);
+    std::sort(popped.begin(), popped.end());
+    for (auto i = 0; i < 100; i++) {
+        ASSERT(popped[i] == i);
+    }
+}
+
+TEST("concurrent priority queue batch pop") {
+    auto q = concurrent_priority_queue<int> { 2 };
+    for (auto i = 0; i < 10; i++) {
+        q.emplace(i);
+    }
+    auto out = std::vector<int> {};
+    while (q.try_pop_batch(out, 4)) {}
+    ASSERT(out.size() == 10);
+}
+
+TEST("concurrent priority queue many threads") {
+    constexpr auto THREADS = 4;
+    constexpr auto PER_THREAD = 20000;
+    auto q = concurrent_priority_queue<int> {};
+    auto sum = std::atomic<int64_t> { 0 };
+    auto popped = std::atomic<int> { 0 };
+    {
+        auto threads = std::vector<std::jthread> {};
+        for (auto t = 0; t < THREADS; t++) {
+            threads.emplace_back([&, t] {
+                for (auto i = 0; i < PER_THREAD; i++) {
+                    q.push(t * PER_THREAD + i);
+                    auto out = 0;
+                    if (i % 2 && q.try_pop(out)) {
+                        sum += out;
+                        popped++;
+                    }
+                }
+            });
+        }
+    }
+    auto out = 0;
+    while (q.try_pop(out)) {
+        sum += out;
+        popped++;
+    }
+    const auto n = int64_t { THREADS * PER_THREAD };
+    ASSERT(popped == n);
+    ASSERT(sum == n * (n - 1) / 2);
+}
@@ -0,0 +1,143 @@
+#include <jlib/dag.h>
+#include <jlib/test_framework.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+TEST("dag topological sort") {
+    auto g = directed_acyclic_graph<std::string> {};
+    auto shirt = g.vertex("shirt");
+    auto tie = g.vertex("tie");
+    auto jacket = g.vertex("jacket");
+    auto socks = g.vertex("socks");
+    auto shoes = g.vertex("shoes");
+    g.edge(shirt, tie);
+    g.edge(tie, jacket);
+    g.edge(shirt, jacket);
+    g.edge(socks, shoes);
+
+    auto order = std::vector<size_t> {};
+    ASSERT(g.topological_sort(order));
+    ASSERT(order.size() == g.size());
+
+    auto position = std::vector<size_t>(g.size());
+    for (auto i = 0u; i < order.size(); i++) {
+        position[order[i]] = i;
+    }
+    ASSERT(position[shirt] < position[tie] && position[tie] < position[jacket]);
+    ASSERT(position[socks] < position[shoes]);
+    ASSERT(g.successors(shirt).size() == 2);
+}
+
+TEST("dag cycle detection") {
+    auto g = directed_acyclic_graph<int> {};
+    for (auto i = 0; i < 4; i++) {
+        g.vertex(i);
+    }
+    g.edge(0, 1);
+    g.edge(1, 2);
+    g.edge(2, 1);
+    g.edge(2, 3);
+
+    auto order = std::vector<size_t> {};
+    ASSERT(!g.topological_sort(order));
+    ASSERT(order == std::vector<size_t> { 0 });
+    ASSERT_THROWS(g.execute([](size_t, int&) {}));
+
+    g.edge(0, 10);
+    ASSERT_THROWS(g.build());
+}
+
+TEST("dag parallel execute respects dependencies") {
+    // layered graph, every vertex depends on every vertex in the previous layer
+    constexpr auto LAYERS = 20;
+    constexpr auto WIDTH = 30;
+    auto g = directed_acyclic_graph<int> {};
+    for (auto i = 0; i < LAYERS * WIDTH; i++) {
+        g.vertex(i / WIDTH);
+    }
+    for (auto l = 1; l < LAYERS; l++) {
+        for (auto a = 0; a < WIDTH; a++) {
+            for (auto b = 0; b < WIDTH; b++) {
+                g.edge((l - 1) * WIDTH + a, l * WIDTH + b);
+            }
+        }
+    }
+
+    auto finished = std::vector<std::atomic<int>>(LAYERS);
+    auto ok = std::atomic<bool> { true };
+    auto engine = task_engine { 4 };
+    g.execute(engine, [&](size_t, int& layer) {
+        if (layer > 0 && finished[layer - 1] != WIDTH) {
+            ok = false;
+        }
+        finished[layer]++;
+    });
+    ASSERT(ok);
+    for (auto& f : finished) {
+        ASSERT(f == WIDTH);
+    }
+}
+
+// chain of running sums: value[i] = input[i] + value[i - 1]
+struct sum_node {
+    int input = 0;
+    int value = 0;
+};
+template <typename Graph> static auto sum_evaluator(Graph& g) {
+    return [&g](size_t v, sum_node& n) {
+        const auto old = n.value;
+        n.value = n.input + (v > 0 ? g[v - 1].value : 0);
+        return n.value != old;
+    };
+}
+
+TEST("dag incremental reevaluate") {
+    constexpr auto N = 100;
+    auto g = directed_acyclic_graph<sum_node> {};
+    for (auto i = 0; i < N; i++) {
+        g.vertex(sum_node { 1 });
+        if (i > 0) {
+            g.edge(i - 1, i);
+        }
+    }
+    ASSERT(g.reevaluate(sum_evaluator(g)) == N);
+    ASSERT(g[N - 1].value == N);
+    ASSERT(!g.any_dirty());
+    ASSERT(g.reevaluate(sum_evaluator(g)) == 0);
+
+    // change near the end: only the tail re-runs
+    g[90].input = 2;
+    g.mark_dirty(90);
+    ASSERT(g.reevaluate(sum_evaluator(g)) == 10);
+    ASSERT(g[N - 1].value == N + 1);
+
+    // no-op change: cut off after the first vertex
+    g.mark_dirty(10);
+    ASSERT(g.reevaluate(sum_evaluator(g)) == 1);
+}
+
+TEST("dag parallel reevaluate") {
+    constexpr auto N = 200;
+    auto g = directed_acyclic_graph<sum_node> {};
+    for (auto i = 0; i < N; i++) {
+        g.vertex(sum_node { 1 });
+        if (i > 0) {
+            g.edge(i - 1, i);
+        }
+    }
+    auto engine = task_engine { 2 };
+    ASSERT(g.reevaluate(engine, sum_evaluator(g)) == N);
+    ASSERT(g[N - 1].value == N);
+
+    g[150].input = 0;
+    g.mark_dirty(150);
+    g.mark_dirty(160);
+    ASSERT(g.reevaluate(engine, sum_evaluator(g)) == 50);
+    ASSERT(g[N - 1].value == N - 1);
+
+    g.mark_dirty(20);
+    ASSERT(g.reevaluate(engine, sum_evaluator(g)) == 1);
+    ASSERT(!g.any_dirty());
+}
@@ -1,11 +1,20 @@
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <string_view>
+#include <vector>
 #include <jlib/binary_file.h>
+#include <jlib/mapped_file.h>
 #include <jlib/test_framework.h>
 #include <jlib/text_file.h>
 
 const auto TMPDIR = std::filesystem::temp_directory_path();
 const auto TEXTFILE = TMPDIR / "jlib_test_textfile.txt";
 const auto BINFILE  = TMPDIR / "jlib_test_binfile.dat";
+const auto BINFILE2 = TMPDIR / "jlib_test_binfile2.dat";
 
 TEST("write text file") {
     auto data = "hello world\nthis is a c++ program\nend";
@@ -41,3 +50,142 @@ TEST("read text file callback") {
     ASSERT(data == decltype(data) { "hello world", "this is a c++ program", "end" });
 }
 
+
+TEST("read text file mapped and chunked") {
+    const auto expected = std::vector<std::string> { "hello world", "this is a c++ program", "end" };
+    auto collect = [&](auto read, auto... args) {
+        auto lines = std::vector<std::string> {};
+        ASSERT(read(TEXTFILE, [&](std::string_view line) -> bool {
+            lines.emplace_back(line);
+            return true;
+        }, args...));
+        return lines;
+    };
+    auto mapped = [](auto&&... args) { return read_text_file_mapped(args...); };
+    auto chunked = [](auto&&... args) { return read_text_file_chunked(args...); };
+    ASSERT(collect(mapped) == expected);
+    ASSERT(collect(chunked) == expected);
+    // lines straddle chunks, and outgrow them
+    ASSERT(collect(chunked, size_t { 4 }) == expected);
+
+    auto count = 0;
+    ASSERT(read_text_file_mapped(TEXTFILE, [&](std::string_view) -> bool { return ++count < 2; }));
+    ASSERT(count == 2);
+    ASSERT(!read_text_file_mapped("SHOULD_NOT_EXIST", [](std::string_view) { return true; }));
+    ASSERT(!read_text_file_chunked("SHOULD_NOT_EXIST", [](std::string_view) { return true; }));
+}
+
+TEST("split lines like getline") {
+    auto lines = std::vector<std::string> {};
+    auto collect = [&](std::string_view line) -> bool {
+        lines.emplace_back(line);
+        return true;
+    };
+    ASSERT(split_lines("a\n\nb\n", collect));
+    ASSERT(lines == std::vector<std::string> { "a", "", "b" });
+    lines.clear();
+    ASSERT(split_lines("", collect));
+    ASSERT(lines.empty());
+}
+
+TEST("mapped file") {
+    auto file = mapped_file(TEXTFILE);
+    ASSERT(file.is_open());
+    ASSERT(file.text() == "hello world\nthis is a c++ program\nend");
+
+    auto moved = std::move(file);
+    ASSERT(!file.is_open() && file.empty());
+    ASSERT(moved.size() == 37);
+
+    ASSERT(write_text_file(TMPDIR / "jlib_test_empty.txt", ""));
+    ASSERT(mapped_file(TMPDIR / "jlib_test_empty.txt").is_open());
+    ASSERT(!mapped_file("SHOULD_NOT_EXIST").is_open());
+}
+
+TEST("split lines across simd blocks") {
+    // newlines at every offset around the 64 byte blocks, and lines longer than a block
+    srand(4321);
+    for (auto n : { 0, 1, 63, 64, 65, 127, 128, 1000 }) {
+        auto text = std::string(n, 'x');
+        for (auto& c : text) {
+            c = rand() % (n < 200 ? 4 : 80) == 0 ? '\n' : 'x';
+        }
+        auto expected = std::vector<std::string> {};
+        auto stream = std::istringstream(text);
+        for (auto line = std::string {}; std::getline(stream, line);) {
+            expected.emplace_back(line);
+        }
+        auto lines = std::vector<std::string> {};
+        ASSERT(split_lines(text, [&](std::string_view line) -> bool {
+            lines.emplace_back(line);
+            return true;
+        }));
+        ASSERT(lines == expected);
+    }
+}
+
+TEST("split lines parallel") {
+    auto text = std::string {};
+    for (auto i = 0; i < 10000; i++) {
+        text += std::to_string(i) + (i % 7 ? "\n" : " a longer line to vary the lengths\n");
+    }
+    text += "last";
+
+    auto engine = task_engine { 4 };
+    auto lock = std::mutex {};
+    auto lines = std::vector<std::string> {};
+    ASSERT(split_lines_parallel(text, [&](std::string_view line) -> bool {
+        auto guard = std::lock_guard { lock };
+        lines.emplace_back(line);
+        return true;
+    }, engine, 1000));
+
+    auto expected = std::vector<std::string> {};
+    split_lines(text, [&](std::string_view line) -> bool {
+        expected.emplace_back(line);
+        return true;
+    });
+    std::sort(lines.begin(), lines.end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT(lines == expected);
+
+    auto seen = std::atomic<int> { 0 };
+    ASSERT(!split_lines_parallel(text, [&](std::string_view) -> bool { return ++seen < 100; }, engine, 1000));
+    ASSERT(seen < 10000);
+}
+
+TEST("binary file errors") {
+    // binary mode: no newline translation, no stopping at a ctrl-z
+    auto data = std::vector<uint8_t> { '\r', '\n', 0x1a, 0, 255, '\n' };
+    ASSERT(write_binary_file(BINFILE2, data));
+    auto read = std::vector<uint8_t> {};
+    ASSERT(read_binary_file(BINFILE2, read));
+    ASSERT(read == data);
+
+    ASSERT(!write_binary_file(TMPDIR / "jlib_no_such_dir" / "x.dat", data));
+}
+
+TEST("binary file reader") {
+    auto ec = std::error_code {};
+    auto reader = binary_file_reader(BINFILE2, ec);
+    ASSERT(!ec && reader.is_open() && reader.size() == 6);
+
+    uint8_t buffer[4] = {};
+    ASSERT(reader.read_exact_at(2, buffer, ec));
+    ASSERT(buffer[0] == 0x1a && buffer[3] == '\n');
+    // short at the end of the file
+    ASSERT(reader.read_at(4, buffer, ec) == 2 && !ec);
+    ASSERT(!reader.read_exact_at(4, buffer, ec));
+    ASSERT(ec == std::errc::result_out_of_range);
+
+    auto missing = binary_file_reader("SHOULD_NOT_EXIST", ec);
+    ASSERT(ec == std::errc::no_such_file_or_directory && !missing.is_open());
+}
+
+TEST("mapped file bytes") {
+    auto file = mapped_file(BINFILE2);
+    ASSERT(file.bytes().size() == 6 && file.bytes()[4] == 255);
+    ASSERT(file.advise(map_advice::sequential));
+    ASSERT(file.advise(map_advice::willneed, 3, 2));
+    ASSERT(file.advise(map_advice::random, 100));
+}
@@ -0,0 +1,122 @@
+#include <fuzz/fuzz_models.h>
+#include <jlib/fuzz.h>
+#include <jlib/hash_map.h>
+#include <jlib/hash_table.h>
+#include <jlib/test_framework.h>
+#include <jlib/top_k.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
+TEST("fuzz hash_map against unordered_map") {
+    auto failure = fuzz_differential<map_model<hash_map<uint32_t, uint32_t>>>();
+    if (failure) {
+        log(failure->report());
+    }
+    ASSERT(!failure);
+}
+
+TEST("fuzz hash_table against unordered_map") {
+    auto failure = fuzz_differential<map_model<hash_table<uint32_t, uint32_t>>>();
+    if (failure) {
+        log(failure->report());
+    }
+    ASSERT(!failure);
+}
+
+TEST("fuzz swiss_vector against map") {
+    auto failure = fuzz_differential<swiss_vector_model>();
+    if (failure) {
+        log(failure->report());
+    }
+    ASSERT(!failure);
+}
+
+struct top_k_model {
+    static constexpr uint8_t op_count = 2;
+    top_k<uint32_t, 8> subject;
+    std::vector<uint32_t> reference;
+
+    void apply(const fuzz_op& op) {
+        if (op.code == 0) {
+            subject.push(op.a);
+            reference.push_back(op.a);
+        } else if (op.b % 32 == 0) {
+            subject.clear();
+            reference.clear();
+        }
+    }
+    void check() const {
+        auto expected = reference;
+        std::sort(expected.begin(), expected.end(), std::greater<> {});
+        expected.resize(std::min(expected.size(), size_t { 8 }));
+        FUZZ_CHECK(subject.sorted() == expected);
+    }
+};
+
+TEST("fuzz top_k against sort") {
+    auto failure = fuzz_differential<top_k_model>();
+    if (failure) {
+        log(failure->report());
+    }
+    ASSERT(!failure);
+}
+
+// loses the size of a key inserted a third time, which the shrinker should reduce to exactly that
+struct broken_counter_model {
+    static constexpr uint8_t op_count = 3;
+    std::map<uint32_t, int> inserts;
+    size_t subject = 0;
+    size_t reference = 0;
+
+    void apply(const fuzz_op& op) {
+        const auto key = op.a % 8;
+        if (op.code == 0 && ++inserts[key] != 3) {
+            subject++;
+        }
+        if (op.code == 0) {
+            reference++;
+        }
+    }
+    void check() const {
+        FUZZ_CHECK(subject == reference);
+    }
+};
+
+TEST("fuzz shrinks a failure to a minimal repro") {
+    auto failure = fuzz_differential<broken_counter_model>();
+    ASSERT(failure);
+    ASSERT(failure->original_size == 200);
+    ASSERT(failure->ops.size() == 3);
+    for (auto& op : failure->ops) {
+        ASSERT(op.code == 0 && op.a == 0 && op.b == 0);
+    }
+    ASSERT(failure->report().find("op 0(0, 0)") != std::string::npos);
+
+    // and replays from the libFuzzer byte encoding
+    const auto bytes = fuzz_encode(failure->ops);
+    ASSERT(bytes.size() == 27);
+    ASSERT(fuzz_run<broken_counter_model>(fuzz_decode(bytes.data(), bytes.size(), broken_counter_model::op_count)));
+}
+
+// counts how many streams the shrinker runs
+struct counted_counter_model : broken_counter_model {
+    static inline size_t runs = 0;
+    counted_counter_model() {
+        runs++;
+    }
+};
+
+TEST("fuzz shrink respects its attempt budget") {
+    const auto ops = std::vector<fuzz_op>(6, fuzz_op { 0, 5, 5 });
+    // running out mid argument simplification used to wrap the counter and shrink without limit
+    for (auto attempts = size_t { 0 }; attempts < 16; attempts++) {
+        auto options = fuzz_options {};
+        options.shrink_attempts = attempts;
+        counted_counter_model::runs = 0;
+        const auto shrunk = fuzz_shrink<counted_counter_model>(ops, options);
+        ASSERT(counted_counter_model::runs <= attempts);
+        ASSERT(fuzz_run<broken_counter_model>(shrunk, 1));
+    }
+}
@@ -1,7 +1,9 @@
 #include <jlib/heapsort.h>
 #include <jlib/test_framework.h>
 
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <vector>
 
 TEST("test static heapsort") {
@@ -47,3 +49,67 @@ TEST("test dynamic heapsort") {
         ASSERT(output[i] <= output[i - 1]);
     }
 }
+
+TEST("heap arity and move-only types") {
+    auto h = dynamic_heap<std::unique_ptr<int>, decltype([](auto& a, auto& b) { return *a < *b; }), 3> {};
+    for (auto i : { 5, 3, 8, 1, 9, 2, 7 }) {
+        h.push(std::make_unique<int>(i));
+    }
+    h.emplace(new int(0));
+    ASSERT(*h.top() == 0);
+    for (auto expected = 0; expected < 10; expected++) {
+        if (expected == 4 || expected == 6) {
+            continue;
+        }
+        ASSERT(*h.pop() == expected);
+    }
+    ASSERT(h.empty());
+}
+
+TEST("indexed heap decrease_key and erase") {
+    auto h = indexed_heap<int, std::less<int>> {};
+    auto handles = std::vector<indexed_heap<int, std::less<int>>::handle> {};
+    for (auto i = 0; i < 100; i++) {
+        handles.emplace_back(h.push(1000 + i));
+    }
+    h.decrease_key(handles[50], 5);
+    h.decrease_key(handles[70], 3);
+    ASSERT_THROWS(h.decrease_key(handles[70], 500));
+    ASSERT(h.top() == 3 && h.top_handle() == handles[70]);
+
+    ASSERT(h.erase(handles[70]) == 3);
+    ASSERT(!h.contains(handles[70]));
+    ASSERT_THROWS(h.erase(handles[70]));
+
+    h.update(handles[50], 2000);
+    ASSERT(h.get(handles[50]) == 2000);
+
+    auto last = h.pop();
+    while (!h.empty()) {
+        auto next = h.pop();
+        ASSERT(last <= next);
+        last = next;
+    }
+    ASSERT(last == 2000);
+}
+
+TEST("in-place heapsort range and span") {
+    auto data = std::vector<int> {};
+    for (auto i = 0; i < 1000; i++) {
+        data.emplace_back(rand() % 100);
+    }
+    auto expected = data;
+    std::sort(expected.begin(), expected.end());
+
+    heapsort(data.begin(), data.end(), std::less<> {});
+    ASSERT(data == expected);
+
+    heapsort(std::span { data });
+    ASSERT(std::is_sorted(data.begin(), data.end(), std::greater<> {}));
+
+    // trivial sizes
+    auto one = std::vector<int> { 1 };
+    heapsort(one.begin(), one.end());
+    heapsort(one.begin(), one.begin());
+    ASSERT(one == std::vector<int> { 1 });
+}
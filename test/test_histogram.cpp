@@ -0,0 +1,87 @@
+#include <jlib/histogram.h>
+#include <jlib/test_framework.h>
+
+#include <thread>
+#include <vector>
+
+TEST("latency histogram buckets cover the range") {
+    using H = latency_histogram<7>;
+    for (auto v : std::vector<uint64_t> { 0, 1, 127, 128, 129, 1000, 123456789, UINT64_MAX / 3, UINT64_MAX }) {
+        ASSERT(H::bucket_lowest(v) <= v);
+        ASSERT(H::bucket_highest(v) >= v);
+        // relative error bounded by the precision
+        ASSERT(H::bucket_highest(v) - H::bucket_lowest(v) <= v / 64);
+    }
+    ASSERT(H::bucket_lowest(100) == 100 && H::bucket_highest(100) == 100);
+}
+
+TEST("latency histogram percentiles") {
+    auto h = latency_histogram {};
+    ASSERT(h.empty());
+    ASSERT(h.percentile(50) == 0);
+    for (auto v = uint64_t { 1 }; v <= 10'000; v++) {
+        h.record(v);
+    }
+    ASSERT(h.count() == 10'000);
+    ASSERT(h.min() == 1);
+    ASSERT(h.max() == 10'000);
+    ASSERT(h.mean() == 5000.5);
+    auto near = [](uint64_t got, uint64_t want) {
+        return got >= want && got <= want + want / 64;
+    };
+    ASSERT(near(h.percentile(50), 5000));
+    ASSERT(near(h.percentile(99), 9900));
+    ASSERT(near(h.percentile(99.9), 9990));
+    ASSERT(h.percentile(100) == 10'000);
+    ASSERT(h.percentile(0) == 1);
+}
+
+TEST("latency histogram tail is not hidden by the mean") {
+    auto h = latency_histogram {};
+    h.record(100, 990);
+    h.record(1'000'000, 10);
+    ASSERT(h.percentile(50) == 100);
+    ASSERT(h.percentile(99) == 100);
+    ASSERT(h.percentile(99.5) >= 1'000'000 - 1'000'000 / 64);
+    ASSERT(h.max() == 1'000'000);
+}
+
+TEST("latency histogram merge") {
+    auto a = latency_histogram {};
+    auto b = latency_histogram {};
+    a.record(10);
+    a.record(20);
+    b.record(5);
+    b.record(5000);
+    a.merge(b);
+    ASSERT(a.count() == 4);
+    ASSERT(a.min() == 5);
+    ASSERT(a.max() == 5000);
+    auto buckets = 0;
+    a.for_each_bucket([&](uint64_t, uint64_t, uint64_t) { buckets++; });
+    ASSERT(buckets == 4);
+    a.reset();
+    ASSERT(a.empty() && a.max() == 0);
+}
+
+TEST("concurrent latency histogram") {
+    auto h = concurrent_latency_histogram {};
+    auto threads = std::vector<std::thread> {};
+    for (auto t = 0; t < 4; t++) {
+        threads.emplace_back([&h, t] {
+            for (auto i = 0; i < 10'000; i++) {
+                h.record(uint64_t(t * 10'000 + i));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    const auto s = h.snapshot();
+    ASSERT(s.count() == 40'000);
+    ASSERT(s.min() == 0);
+    ASSERT(s.max() == 39'999);
+    ASSERT(s.mean() == 19'999.5);
+    h.reset();
+    ASSERT(h.snapshot().empty());
+}
@@ -0,0 +1,119 @@
+#include <jlib/log_async.h>
+#include <jlib/test_framework.h>
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// capture everything written to std::cerr for the lifetime of the object
+struct cerr_capture {
+    std::ostringstream captured;
+    std::streambuf* old = std::cerr.rdbuf(captured.rdbuf());
+    ~cerr_capture() {
+        std::cerr.rdbuf(old);
+    }
+};
+
+TEST_SERIAL("async log formats on the background thread") {
+    auto capture = cerr_capture {};
+    {
+        auto logger = async_logger {};
+        auto temporary = std::string("temporary string");
+        logger.log(1, 2.5, temporary, QUOTE "quoted");
+        temporary = "overwritten";
+        logger.log<false, false>("no", "spaces");
+        logger.flush();
+    }
+    ASSERT(capture.captured.str() == "LOG: 1 2.5 temporary string 'quoted' \nnospaces\n");
+}
+
+TEST_SERIAL("async log from many threads") {
+    auto capture = cerr_capture {};
+    {
+        auto logger = async_logger { { .capacity = 64, .overflow = log_overflow::block } };
+        auto threads = std::vector<std::jthread> {};
+        for (auto t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (auto i = 0; i < 1000; i++) {
+                    logger.log<false, false>(t, ':', i);
+                }
+            });
+        }
+    }
+    auto lines = 0;
+    auto in = std::istringstream { capture.captured.str() };
+    for (auto line = std::string {}; std::getline(in, line);) {
+        lines++;
+    }
+    ASSERT(lines == 4000);
+}
+
+// holds the first write until opened, so the background thread can be parked mid-batch
+struct gate_log_sink final : public log_sink {
+    std::atomic<bool> entered = false;
+    std::atomic<bool> open = false;
+    void write(std::string_view) override {
+        if (!entered.exchange(true)) {
+            entered.notify_all();
+            open.wait(false);
+        }
+    }
+};
+
+TEST("async log flush waits for this producer's record") {
+    constexpr auto threads = 4;
+    constexpr auto per_thread = 2000;
+    auto seen = std::vector<std::atomic<bool>>(threads * per_thread);
+    {
+        // small ring and a busy consumer, so producers overtake each other mid-publish
+        auto queue = log_queue<uint32_t>(
+            { .capacity = 8 },
+            [&](uint32_t& id) {
+                seen[id].store(true, std::memory_order_relaxed);
+            },
+            [](uint64_t) {}
+        );
+        auto failures = std::atomic<int> { 0 };
+        auto workers = std::vector<std::thread> {};
+        for (auto t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                for (auto i = 0; i < per_thread; i++) {
+                    const auto id = uint32_t(t * per_thread + i);
+                    queue.push(id);
+                    queue.flush();
+                    failures += seen[id].load(std::memory_order_relaxed) ? 0 : 1;
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        ASSERT(failures == 0);
+    }
+}
+
+TEST_SERIAL("async log overflow count") {
+    auto capture = cerr_capture {};
+    auto gate = std::make_shared<gate_log_sink>();
+    add_log_sink(gate);
+    auto dropped = uint64_t { 0 };
+    {
+        auto logger = async_logger { { .capacity = 2, .overflow = log_overflow::count } };
+        // park the background thread in the sink, then log more than the ring holds
+        logger.log("first");
+        gate->entered.wait(false);
+        for (auto i = 0; i < 100; i++) {
+            logger.log("spam", i);
+        }
+        dropped = logger.dropped();
+        gate->open = true;
+        gate->open.notify_all();
+        logger.flush();
+    }
+    remove_log_sink(gate);
+    ASSERT(dropped == 98);
+    ASSERT(capture.captured.str().find("LOG: dropped 98 records") != std::string::npos);
+}
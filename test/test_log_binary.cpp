@@ -0,0 +1,80 @@
+#include <jlib/jenum.h>
+#include <jlib/log_binary.h>
+#include <jlib/test_framework.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+jenum_class(BinaryColour, Red, Green = 5, Blue);
+
+TEST("binary log record round trip") {
+    static auto site = binary_log_site { "a {} b {} c {} d {} e {}", __FILE__, __LINE__ };
+    const auto info = binary_site_info_for<int, double, std::string, BinaryColour, bool>(site);
+    const auto record = binary_log_record { 1, -42, 2.5, std::string("str"), BinaryColour::Green, true };
+
+    auto out = std::string {};
+    ASSERT(format_binary_record(info, record.payload, record.size, out));
+    ASSERT(out == "LOG: a -42 b 2.5 c str d Green e 1\n");
+}
+
+TEST("binary log extra args and truncation") {
+    static auto site = binary_log_site { "only {}", __FILE__, __LINE__ };
+    const auto info = binary_site_info_for<unsigned, const char*, std::string, char>(site);
+    const auto long_string = std::string(1000, 'x');
+    const auto record = binary_log_record { 1, 7u, "extra", long_string, 'c' };
+    ASSERT(record.size == binary_log_record::payload_size);
+
+    auto out = std::string {};
+    ASSERT(format_binary_record(info, record.payload, record.size, out));
+    ASSERT(out.starts_with("LOG: only 7 extra xxx"));
+    ASSERT(out.ends_with("x c\n"));
+}
+
+TEST("binary log raw file decode") {
+    const auto path = std::filesystem::temp_directory_path() / "jlib_test_binary_log.jlb";
+    {
+        auto logger = binary_logger { { .path = path } };
+        for (auto i = 0; i < 3; i++) {
+            static auto site = binary_log_site { "iteration {} of {}", __FILE__, __LINE__ };
+            logger.log(site, i, 3);
+        }
+        static auto other = binary_log_site { "colour {}", __FILE__, __LINE__ };
+        logger.log(other, BinaryColour::Blue);
+    }
+
+    auto file = std::ifstream(path, std::ios::binary);
+    auto out = std::string {};
+    ASSERT(decode_binary_log(file, out));
+    ASSERT(out == "LOG: iteration 0 of 3\nLOG: iteration 1 of 3\nLOG: iteration 2 of 3\nLOG: colour Blue\n");
+
+    auto garbage = std::istringstream { "nope" };
+    ASSERT(!decode_binary_log(garbage, out));
+
+    // a corrupt site id fails the decode rather than sizing a table by it
+    auto corrupt = std::istringstream { std::string { "JLB1S\xff\xff\xff\x7f", 9 } };
+    ASSERT(!decode_binary_log(corrupt, out));
+}
+
+TEST("binary log macro") {
+    // the only user of the global binary logger in the tests, so it hasn't started yet
+    const auto path = std::filesystem::temp_directory_path() / "jlib_test_binary_log_macro.jlb";
+    configure_binary_log({ .path = path });
+    LOG_BINARY("binary log macro {} {}", 1, "two");
+    LOG_BINARY("binary log macro, no arguments");
+    binary_log().flush();
+
+    auto threw = false;
+    try {
+        configure_binary_log({});
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    auto file = std::ifstream(path, std::ios::binary);
+    auto out = std::string {};
+    ASSERT(decode_binary_log(file, out));
+    ASSERT(out == "LOG: binary log macro 1 two\nLOG: binary log macro, no arguments\n");
+}
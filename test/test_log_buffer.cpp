@@ -0,0 +1,86 @@
+#include <jlib/log.h>
+#include <jlib/test_framework.h>
+
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+TEST("log_buffer formatting matches ostream") {
+    auto b = log_buffer {};
+    log_format(b, 1, -2, 2.5, 1.0 / 3, uint8_t { 7 }, true, 'c', "str", std::string_view { "sv" });
+    ASSERT(b.data == "LOG: 1 -2 2.5 0.333333 7 1 c str sv \n");
+
+    log_format<false, false>(b, std::hex, 255, std::dec, 255);
+    ASSERT(b.data == "ff255\n");
+
+    log_format<false, false>(b, "ab", log_pad { 5, '.' }, QUOTE "q", Colors::FG_RED);
+    ASSERT(b.data == "ab...'q'\033[31m\n");
+
+    // no fast path: falls back to operator<<
+    log_format<true, false>(b, std::vector { 1, 2 });
+    ASSERT(b.data == "{ 1, 2 } \n");
+}
+
+TEST("log_buffer small and negative integers match ostream") {
+    auto expect = std::ostringstream {};
+    auto b = log_buffer {};
+    auto both = [&](auto... args) {
+        expect.str({});
+        (log_stream(expect, args), ...);
+        b.begin();
+        (log_stream(b, args), ...);
+        return b.data == expect.str();
+    };
+    ASSERT(both(int8_t { 'A' }, uint8_t { 65 }, int8_t { -1 }));
+    ASSERT(both(std::hex, -1, short { -1 }, -255L, uint8_t { 255 }, std::dec, -1));
+    ASSERT(both(std::oct, -8, std::dec, -8));
+    ASSERT(both(std::hex, int8_t { 'z' }, 'z'));
+}
+
+// formats the same arguments with log_buffer and an ostream, as log() did before log_buffer
+template<typename... Args> static bool matches_ostream(log_buffer& b, Args&&... args) {
+    auto expect = std::ostringstream {};
+    log_pf<true, true>(static_cast<std::ostream&>(expect), args...);
+    log_format(b, args...);
+    return b.data == expect.str();
+}
+
+TEST("log_buffer manipulators match ostream") {
+    auto b = log_buffer {};
+    ASSERT(matches_ostream(b, std::boolalpha, true, false, 1));
+    ASSERT(matches_ostream(b, std::fixed, 2.5, std::setprecision(2), 1.0 / 3, std::scientific, 1234.5));
+    ASSERT(matches_ostream(b, std::setprecision(10), 1.0 / 3, std::showbase, std::hex, 255, std::dec, 255));
+    ASSERT(matches_ostream(b, std::hex, std::uppercase, 255, std::dec, 255, std::noboolalpha, true));
+    ASSERT(matches_ostream(b, std::setw(6), std::setfill('.'), 42, "x", QUOTE 7, log_pad { 40 }, 1));
+    ASSERT(matches_ostream(b, std::hex, std::vector { 10, 11 }, 12));
+
+    // and the next line starts from the defaults again
+    log_format<false>(b, std::boolalpha, true, ' ', std::fixed, std::setprecision(1), 2.25);
+    ASSERT(b.data == "LOG:true 2.2\n");
+    log_format(b, true, 2.25, 255);
+    ASSERT(b.data == "LOG: 1 2.25 255 \n");
+}
+
+struct logs_while_printed {};
+static std::ostream& operator<<(std::ostream& o, const logs_while_printed&) {
+    auto inner = log_buffer {};
+    log_format(inner, "inner", std::vector { 3 });
+    return o << "outer";
+}
+
+TEST("log_buffer fallback survives an operator<< that logs") {
+    auto b = log_buffer {};
+    log_format(b, std::vector { 1 }, logs_while_printed {}, std::vector { 2 });
+    ASSERT(b.data == "LOG: { 1 } outer { 2 } \n");
+}
+
+TEST("log_buffer reuses its storage") {
+    auto b = log_buffer {};
+    log_format(b, "warm up the buffer", 123456789, 1.5);
+    const auto* data = b.data.data();
+    const auto capacity = b.data.capacity();
+    for (auto i = 0; i < 100; i++) {
+        log_format(b, "same length line", i % 10, 2.5);
+    }
+    ASSERT(b.data.data() == data && b.data.capacity() == capacity);
+}
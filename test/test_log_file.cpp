@@ -0,0 +1,45 @@
+#include <jlib/log_file.h>
+#include <jlib/test_framework.h>
+#include <jlib/text_file.h>
+
+#include <filesystem>
+
+static const auto LOGFILE = std::filesystem::temp_directory_path() / "jlib_test_log_file.log";
+
+static void remove_log_files() {
+    for (auto i = 0; i <= 3; i++) {
+        std::filesystem::remove(i ? std::filesystem::path { LOGFILE.string() + '.' + std::to_string(i) } : LOGFILE);
+    }
+}
+
+TEST_SERIAL("file log sink buffers until flush") {
+    remove_log_files();
+    auto sink = std::make_shared<file_log_sink>(LOGFILE, file_log_options { .flush_interval = std::chrono::milliseconds { 0 } });
+    ASSERT(sink->is_open());
+
+    add_log_sink(sink);
+    log("to the file sink", 42);
+    remove_log_sink(sink);
+    ASSERT(std::filesystem::file_size(LOGFILE) == 0);
+
+    sink->flush();
+    auto contents = std::string {};
+    ASSERT(read_text_file(LOGFILE, contents));
+    ASSERT(contents == "LOG: to the file sink 42 \n");
+}
+
+TEST("file log sink rotates by size") {
+    remove_log_files();
+    {
+        auto sink = file_log_sink { LOGFILE, { .buffer_size = 16, .max_size = 100, .max_files = 2 } };
+        const auto line = std::string(39, 'x') + '\n';
+        for (auto i = 0; i < 10; i++) {
+            sink.write(line);
+        }
+    }
+    ASSERT(std::filesystem::file_size(LOGFILE) == 80);
+    ASSERT(std::filesystem::file_size(LOGFILE.string() + ".1") == 80);
+    ASSERT(std::filesystem::file_size(LOGFILE.string() + ".2") == 80);
+    ASSERT(!std::filesystem::exists(LOGFILE.string() + ".3"));
+    remove_log_files();
+}
@@ -0,0 +1,47 @@
+#include <jlib/log.h>
+#include <jlib/test_framework.h>
+
+static auto test_module = log_module { "test_module" };
+
+TEST_SERIAL("log levels skip argument evaluation") {
+    const auto old = log_threshold().load();
+    log_threshold() = log_level::warn;
+
+    auto evaluated = 0;
+    auto arg = [&] { return ++evaluated; };
+    LOG_DEBUG("never formatted", arg());
+    LOG_INFO("never formatted", arg());
+    ASSERT(evaluated == 0);
+    LOG_WARN("log levels test warning", arg());
+    LOG_ERROR("log levels test error", arg());
+    ASSERT(evaluated == 2);
+
+    log_threshold() = old;
+}
+
+TEST_SERIAL("log module overrides") {
+    const auto old = log_threshold().load();
+    log_threshold() = log_level::error;
+
+    auto evaluated = 0;
+    auto arg = [&] { return ++evaluated; };
+    LOG_M(test_module, info, "module follows the global threshold", arg());
+    ASSERT(evaluated == 0);
+
+    ASSERT(set_log_levels("error,test_module=debug"));
+    LOG_M(test_module, debug, "module override", arg());
+    LOG_M(test_module, trace, "below the override", arg());
+    ASSERT(evaluated == 1);
+
+    // modules declared after the override pick it up
+    auto late = log_module { "late_module" };
+    ASSERT(set_log_levels("late_module=trace"));
+    ASSERT(late.enabled(log_level::trace));
+
+    ASSERT(!set_log_levels("test_module=loud"));
+    ASSERT(!set_log_levels("=info"));
+
+    test_module.reset_level();
+    ASSERT(!test_module.enabled(log_level::warn));
+    log_threshold() = old;
+}
@@ -0,0 +1,57 @@
+#include <jlib/log.h>
+#include <jlib/test_framework.h>
+
+#include <cmath>
+#include <vector>
+
+// collects log lines instead of printing them
+struct capture_sink final : public log_sink {
+    std::vector<std::string> lines;
+    void write(std::string_view str) override {
+        lines.emplace_back(str);
+    }
+};
+
+TEST_SERIAL("log every n and dropped summary") {
+    auto sink = std::make_shared<capture_sink>();
+    set_log_sinks({ sink });
+    for (auto i = 0; i < 10; i++) {
+        LOG_EVERY_N(warn, 4, "every n", i);
+    }
+    set_log_sinks({ std::make_shared<stderr_log_sink>() });
+    ASSERT(sink->lines == std::vector<std::string> { "WARN: every n 0 \n", "WARN: every n 4 (dropped 3) \n", "WARN: every n 8 (dropped 3) \n" });
+}
+
+TEST_SERIAL("log rate limited bursts then drops") {
+    auto sink = std::make_shared<capture_sink>();
+    set_log_sinks({ sink });
+    for (auto i = 0; i < 1000; i++) {
+        LOG_RATE_LIMITED(error, 1, 5, "rate limited", i);
+    }
+    set_log_sinks({ std::make_shared<stderr_log_sink>() });
+    ASSERT(sink->lines.size() == 5);
+}
+
+TEST("log rate limiter with degenerate rates") {
+    for (auto rate : { 0.0, -1.0, std::nan("") }) {
+        auto limiter = log_limiter {};
+        ASSERT(!limiter.allow_rate(rate, 5));
+        ASSERT(limiter.take_dropped() == 1);
+    }
+    // tiny rates still allow the burst, then nothing
+    auto limiter = log_limiter {};
+    ASSERT(limiter.allow_rate(1e-30, 2) && limiter.allow_rate(1e-30, 2));
+    ASSERT(!limiter.allow_rate(1e-30, 2));
+}
+
+TEST_SERIAL("log sampled") {
+    auto sink = std::make_shared<capture_sink>();
+    set_log_sinks({ sink });
+    for (auto i = 0; i < 10000; i++) {
+        LOG_SAMPLED(error, 0.01, "sampled", i);
+    }
+    LOG_SAMPLED(error, 0.0, "never");
+    set_log_sinks({ std::make_shared<stderr_log_sink>() });
+
+    ASSERT(sink->lines.size() > 20 && sink->lines.size() < 300);
+}
@@ -0,0 +1,45 @@
+#include <jlib/parallel_sort.h>
+#include <jlib/test_framework.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include <vector>
+
+TEST("parallel merge") {
+    // runs of very different lengths and lots of duplicates, past the leaf size
+    auto engine = task_engine { 4 };
+    for (auto [n1, n2] : { std::pair { 0, 5 }, { 100'000, 3 }, { 7, 60'000 }, { 50'000, 50'000 } }) {
+        auto data = std::vector<int>(n1 + n2);
+        for (auto& d : data) {
+            d = rand() % 1000;
+        }
+        std::sort(data.begin(), data.begin() + n1);
+        std::sort(data.begin() + n1, data.end());
+        auto expected = data;
+        std::sort(expected.begin(), expected.end());
+        auto compare = std::less<> {};
+        parallel_merge(engine, data.begin(), data.begin() + n1, data.end(), compare);
+        ASSERT(data == expected);
+    }
+}
+
+TEST("parallel sort") {
+    for (auto n : { 0, 10, 100'000, 1'000'003 }) {
+        auto data = std::vector<uint32_t>(n);
+        for (auto& d : data) {
+            d = rand();
+        }
+        auto expected = data;
+        std::sort(expected.begin(), expected.end());
+
+        for (auto threads : { 1, 3, 8 }) {
+            auto engine = task_engine { size_t(threads) };
+            auto copy = data;
+            parallel_sort(copy.begin(), copy.end(), std::less<> {}, engine);
+            ASSERT(copy == expected);
+        }
+    }
+}
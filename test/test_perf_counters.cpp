@@ -0,0 +1,24 @@
+#include <jlib/perf_counters.h>
+#include <jlib/test_framework.h>
+
+#include <numeric>
+#include <vector>
+
+TEST("perf counters open or degrade to no-ops") {
+    auto counters = perf_counters {};
+    counters.reset();
+    counters.start();
+    auto v = std::vector<int>(1 << 16, 1);
+    const auto sum = std::accumulate(v.begin(), v.end(), 0);
+    counters.stop();
+    ASSERT(sum == 1 << 16);
+    const auto values = counters.read();
+    if (counters.is_open()) {
+        ASSERT(values[size_t(perf_event::cycles)] > 0 && values[size_t(perf_event::cycles)] != perf_unavailable);
+    } else {
+        for (auto x : values) {
+            ASSERT(x == perf_unavailable);
+        }
+    }
+    ASSERT(perf_event_name(perf_event::cache_misses) == "cache-misses");
+}
@@ -0,0 +1,91 @@
+#include <jlib/profile.h>
+#include <jlib/test_framework.h>
+#include <jlib/timer.h>
+
+#include <sstream>
+#include <thread>
+
+static void profiled_leaf() {
+    PROFILE_ZONE("test leaf");
+    std::this_thread::sleep_for(100us);
+}
+
+TEST_SERIAL("profile zones aggregate per zone") {
+    profile_reset();
+    for (auto i = 0; i < 10; i++) {
+        PROFILE_ZONE("test outer");
+        profiled_leaf();
+    }
+    auto report = profile_report();
+    auto* leaf = (profile_zone_stats*)nullptr;
+    auto* outer = (profile_zone_stats*)nullptr;
+    for (auto& s : report) {
+        if (s.name == "test leaf") {
+            leaf = &s;
+        }
+        if (s.name == "test outer") {
+            outer = &s;
+        }
+    }
+    ASSERT(leaf && outer);
+    ASSERT(leaf->count == 10);
+    ASSERT(outer->count == 10);
+    ASSERT(leaf->min_ns >= 100'000);
+    ASSERT(outer->total_ns >= leaf->total_ns);
+    ASSERT(leaf->quantile_ns(0.5) >= leaf->min_ns);
+    ASSERT(leaf->quantile_ns(1.0) <= leaf->max_ns);
+}
+
+TEST_SERIAL("profile zones from several threads") {
+    profile_reset();
+    auto threads = std::vector<std::thread> {};
+    for (auto t = 0; t < 4; t++) {
+        threads.emplace_back([] {
+            for (auto i = 0; i < 1000; i++) {
+                PROFILE_ZONE("test threaded");
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto count = uint64_t { 0 };
+    for (auto& s : profile_report()) {
+        if (s.name == "test threaded") {
+            count = s.count;
+        }
+    }
+    ASSERT(count == 4000);
+}
+
+TEST_SERIAL("profile disabled records nothing") {
+    profile_reset();
+    profiling_enabled() = false;
+    for (auto i = 0; i < 10; i++) {
+        PROFILE_ZONE("test disabled");
+    }
+    profiling_enabled() = true;
+    for (auto& s : profile_report()) {
+        ASSERT(s.name != "test disabled");
+    }
+}
+
+TEST_SERIAL("profile chrome trace") {
+    profile_reset();
+    {
+        PROFILE_ZONE("test \"quoted\"");
+    }
+    auto out = std::ostringstream {};
+    write_chrome_trace(out);
+    const auto s = out.str();
+    ASSERT(s.starts_with("{\"traceEvents\":["));
+    ASSERT(s.find("\"name\":\"test \\\"quoted\\\"\"") != std::string::npos);
+    ASSERT(s.find("\"ph\":\"X\"") != std::string::npos);
+    ASSERT(s.ends_with("]}\n"));
+}
+
+TEST("profile clock works with timer") {
+    auto timer = Timer<profile_clock, std::chrono::nanoseconds> {};
+    std::this_thread::sleep_for(1ms);
+    ASSERT(timer.lap() >= 1'000'000);
+}
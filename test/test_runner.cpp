@@ -0,0 +1,107 @@
+#include <jlib/log.h>
+#include <jlib/test_framework.h>
+
+TEST("test glob match") {
+    ASSERT(test_glob_match("*", ""));
+    ASSERT(test_glob_match("*", "anything"));
+    ASSERT(test_glob_match("hash*", "hash_map fuzzy test"));
+    ASSERT(test_glob_match("*fuzzy*", "hash_map fuzzy test"));
+    ASSERT(test_glob_match("test_log_?????", "test_log_level"));
+    ASSERT(test_glob_match("a*b*c", "aXbYbZc"));
+    ASSERT(!test_glob_match("hash", "hash_map"));
+    ASSERT(!test_glob_match("a*b*c", "aXbYbZ"));
+    ASSERT(!test_glob_match("?", ""));
+}
+
+TEST("log capture scope keeps output on this thread") {
+    auto outer = log_capture_scope {};
+    {
+        auto inner = log_capture_scope {};
+        log<false, false>("inner");
+        ASSERT(inner.text == "inner\n");
+    }
+    log<false, false>("outer");
+    ASSERT(outer.text == "outer\n");
+}
+
+TEST("parse test args") {
+    const char* argv[] = { "test_jlib", "-j3", "--filter=log*", "test_dag", "--slowest=0" };
+    const auto options = parse_test_args(5, const_cast<char**>(argv));
+    ASSERT(options.jobs == 3);
+    ASSERT(options.filters == std::vector<std::string> { "log*" });
+    ASSERT(options.stems == std::vector<std::string> { "test_dag" });
+    ASSERT(options.slowest == 0);
+}
+
+#if (defined __unix__ || defined __APPLE__)
+#include <csignal>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+
+// not registered, only run through run_test_isolated
+template<typename F> struct isolated_test final : public TestBase {
+    F f;
+    isolated_test(const char* name, F f): TestBase(name, __FILE__, __LINE__, false, false), f(f) {}
+    void func() override {
+        f();
+    }
+};
+
+TEST("isolated tests report pass, fail, crash and timeout") {
+    auto pass = isolated_test("passes", [] { std::printf("to stdout\n"); });
+    auto outcome = run_test_isolated(pass, 10);
+    ASSERT(outcome.status == test_status::passed);
+    ASSERT(outcome.output.find("to stdout") != std::string::npos);
+    ASSERT(outcome.output.find("success") != std::string::npos);
+
+    auto fail = isolated_test("fails", [] { ASSERT(1 + 1 == 3); });
+    ASSERT(run_test_isolated(fail, 10).status == test_status::failed);
+
+    auto crash = isolated_test("crashes", [] { std::raise(SIGSEGV); });
+    outcome = run_test_isolated(crash, 10);
+    ASSERT(outcome.status == test_status::crashed);
+    ASSERT(outcome.signal == SIGSEGV);
+
+    auto hang = isolated_test("hangs", [] {
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT(run_test_isolated(hang, 0.2).status == test_status::timed_out);
+    ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+}
+
+TEST("isolated tests time out while printing or after closing their output") {
+    auto chatty = isolated_test("prints forever", [] {
+        while (true) {
+            std::printf("still going\n");
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    auto outcome = run_test_isolated(chatty, 0.2);
+    ASSERT(outcome.status == test_status::timed_out);
+    ASSERT(outcome.output.find("still going") != std::string::npos);
+    ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    auto silent = isolated_test("closes output and hangs", [] {
+        close(STDOUT_FILENO);
+        close(STDERR_FILENO);
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    start = std::chrono::steady_clock::now();
+    ASSERT(run_test_isolated(silent, 0.2).status == test_status::timed_out);
+    ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    // and one that closes its output but then exits normally is still reaped
+    auto quiet = isolated_test("closes output and passes", [] {
+        close(STDOUT_FILENO);
+        close(STDERR_FILENO);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    ASSERT(run_test_isolated(quiet, 10).status == test_status::passed);
+}
+#endif
@@ -0,0 +1,92 @@
+#include <jlib/task_engine.h>
+#include <jlib/test_framework.h>
+
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+TEST("work stealing deque owner and thieves") {
+    constexpr auto N = 100000;
+    auto deque = work_stealing_deque<int*> { 4 };
+    auto items = std::vector<int>(N);
+    std::iota(items.begin(), items.end(), 0);
+
+    auto stolen = std::atomic<int64_t> { 0 };
+    auto done = std::atomic<bool> { false };
+    auto thieves = std::vector<std::jthread> {};
+    for (auto t = 0; t < 3; t++) {
+        thieves.emplace_back([&] {
+            while (!done || !deque.empty()) {
+                if (auto* i = deque.steal()) {
+                    stolen += *i;
+                }
+            }
+        });
+    }
+
+    auto popped = int64_t { 0 };
+    for (auto i = 0; i < N; i++) {
+        deque.push(&items[i]);
+        if (i % 3 == 0) {
+            if (auto* p = deque.pop()) {
+                popped += *p;
+            }
+        }
+    }
+    while (auto* p = deque.pop()) {
+        popped += *p;
+    }
+    done = true;
+    thieves.clear();
+
+    ASSERT(popped + stolen == int64_t { N } * (N - 1) / 2);
+}
+
+TEST("task engine submit and wait_group") {
+    auto engine = task_engine { 4 };
+    auto group = wait_group {};
+    auto count = std::atomic<int> { 0 };
+    for (auto i = 0; i < 1000; i++) {
+        engine.submit(group, [&] { count++; });
+    }
+    engine.wait(group);
+    ASSERT(count == 1000);
+}
+
+TEST("task engine nested parallel_for") {
+    auto engine = task_engine { 3 };
+    auto totals = std::vector<std::atomic<int>>(64);
+    parallel_for(engine, 0, totals.size(), [&](size_t i) {
+        // waiting inside a worker runs other tasks rather than deadlocking
+        parallel_for(engine, 0, 100, [&](size_t) { totals[i]++; }, 7);
+    });
+    for (auto& t : totals) {
+        ASSERT(t == 100);
+    }
+}
+
+TEST("task engine drains queue on destruction") {
+    auto count = std::atomic<int> { 0 };
+    {
+        auto engine = task_engine { 2 };
+        for (auto i = 0; i < 100; i++) {
+            engine.submit([&] { count++; });
+        }
+    }
+    ASSERT(count == 100);
+}
+
+TEST("task engine short lived wait_groups") {
+    // each group dies as soon as wait returns, while the worker that finished it may still be in done()
+    // (run under -fsanitize=address or thread to catch a use after free)
+    auto engine = task_engine { 2 };
+    auto count = std::atomic<int> { 0 };
+    for (auto i = 0; i < 2000; i++) {
+        auto group = std::make_unique<wait_group>();
+        engine.submit(*group, [&] { count++; });
+        engine.wait(*group);
+    }
+    ASSERT(count == 2000);
+}
@@ -0,0 +1,48 @@
+#include <jlib/test_framework.h>
+#include <jlib/top_k.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+TEST("top_k keeps the K largest") {
+    auto input = std::vector<int> {};
+    for (auto i = 0; i < 10000; i++) {
+        input.emplace_back(rand());
+    }
+
+    auto top = top_k<int, 100> {};
+    for (auto i : input) {
+        top.push(i);
+    }
+    ASSERT(top.full());
+
+    std::sort(input.begin(), input.end(), std::greater<> {});
+    input.resize(100);
+    ASSERT(top.sorted() == input);
+    ASSERT(top.worst() == input.back());
+}
+
+TEST("top_k smallest and partially filled") {
+    auto top = top_k<int, 5, std::less<int>> {};
+    for (auto i : { 9, 3, 7 }) {
+        top.push(i);
+    }
+    ASSERT(!top.full() && top.size() == 3);
+    ASSERT(top.sorted() == std::vector<int> { 3, 7, 9 });
+
+    for (auto i : { 1, 8, 2, 10 }) {
+        top.push(i);
+    }
+    ASSERT(top.sorted() == std::vector<int> { 1, 2, 3, 7, 8 });
+    ASSERT(!top.push(100));
+}
+
+TEST("top_k merge") {
+    auto parts = std::array<top_k<int, 10>, 4> {};
+    for (auto i = 0; i < 1000; i++) {
+        parts[i % 4].push(i);
+    }
+    auto merged = merge_top_k(parts);
+    ASSERT(merged.sorted() == std::vector<int> { 999, 998, 997, 996, 995, 994, 993, 992, 991, 990 });
+}
@@ -0,0 +1,30 @@
+// log_decode.cpp
+// formats a raw binary log written by binary_logger (see jlib/log_binary.h)
+// usage: jlib_log_decode <file.jlb>
+
+#define JLIB_IMPLEMENTATION
+#include <jlib/log_binary.h>
+
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <file.jlb>\n";
+        return 1;
+    }
+    auto file = std::ifstream(argv[1], std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "couldn't open " << argv[1] << '\n';
+        return 1;
+    }
+
+    auto out = std::string {};
+    const auto ok = decode_binary_log(file, out);
+    std::cout << out;
+    if (!ok) {
+        std::cerr << "malformed binary log\n";
+        return 1;
+    }
+    return 0;
+}